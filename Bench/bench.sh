@@ -0,0 +1,85 @@
+#!/bin/sh
+#
+#	bench.sh - Time prep over synthetic collations of several sizes.
+#
+#	Usage: bench.sh [-b] prep {units:witnesses}+
+#
+#	Each size is made by benchgen (with $BENCHGEN options, if any) in
+#	run/, and prep is run on it with --stats.  The wall seconds of each
+#	phase, summed over its calls, go in run/results as
+#
+#		units:witnesses phase wall cpu maxRssKB
+#
+#	and are compared with those in baseline:  a phase more than twice
+#	as slow (and slower by more than 0.05s) is reported, and the exit
+#	status is 1.  With -b, run/results becomes the new baseline.
+#
+
+newBase=no
+if [ "$1" = "-b" ]; then
+	newBase=yes
+	shift
+fi
+prep=$1
+shift
+case "$prep" in
+/*)	;;
+*)	prep=`pwd`/$prep ;;
+esac
+
+mkdir -p run
+: > run/results
+for size in "$@"; do
+	units=${size%:*}
+	wits=${size#*:}
+	name=u${units}w${wits}
+
+	rm -f run/$name.stats.json
+	(cd run; ../benchgen $BENCHGEN -u $units -w $wits $name) || exit 2
+	if ! (cd run; FRAG=1 CORR=1 $prep $name --stats > $name.out 2> $name.err) \
+	|| [ ! -f run/$name.stats.json ]; then
+		echo "$size: prep failed (see run/$name.err)"
+		exit 2
+	fi
+
+	# The phases are one a line in the JSON
+	sed -n 's/.*"name": "\([A-Za-z]*\)", "wall": \([0-9.]*\), "cpu": \([0-9.]*\), "maxRssKB": \([0-9]*\).*/\1 \2 \3 \4/p' \
+		run/$name.stats.json |
+	awk -v size=$size '
+		!($1 in wall) { order[n++] = $1 }
+		{ wall[$1] += $2; cpu[$1] += $3; if ($4 > rss[$1]) rss[$1] = $4 }
+		END { for (i = 0; i < n; i++) printf "%s %s %.6f %.6f %d\n", size, order[i], wall[order[i]], cpu[order[i]], rss[order[i]] }
+	' >> run/results
+	rm -f run/$name run/$name.chron run/$name.tx run/$name.no run/$name.vr
+done
+
+if [ $newBase = yes ]; then
+	cp run/results baseline
+	echo "New baseline:"
+	cat baseline
+	exit 0
+fi
+
+if [ ! -f baseline ]; then
+	cat run/results
+	echo "No baseline to compare with (make baseline)"
+	exit 0
+fi
+
+awk '
+	NR == FNR { base[$1 " " $2] = $3; next }
+	{
+		key = $1 " " $2
+		was = (key in base) ? base[key] : -1
+		flag = ""
+		if (was >= 0 && $3 > 2 * was && $3 - was > 0.05) {
+			flag = "  SLOWER"
+			slow = 1
+		}
+		if (was >= 0)
+			printf "%-14s %-12s %10.4fs %10.4fs %6.2fx%s\n", $1, $2, $3, was, (was > 0) ? $3 / was : 1, flag
+		else
+			printf "%-14s %-12s %10.4fs %11s\n", $1, $2, $3, "(new)"
+	}
+	END { exit slow }
+' baseline run/results
@@ -0,0 +1,267 @@
+
+/*
+	benchgen - Make a synthetic collation for benchmarking prep.
+
+	Usage: benchgen [options] base
+
+	Writes base (the collation) and base.chron (its Chron file).
+
+	Options:
+		-w N      - Witnesses (200)
+		-u N      - Variation units (10000)
+		-p N      - Parallels, /a /b ... (0 for none)
+		-c N      - Percent of witnesses with correctors :1, :2 (10)
+		-m N      - Family macros, as $A $B ... (8)
+		-l N      - Percent of witnesses with a lacuna %- ... %+ (10)
+		-x N      - Percent of units weighted, |*n or |n (10)
+		-s N      - Seed (1)
+
+	Each unit is mostly its majority reading, as $*, with a family or
+	two on another reading, and a scattering of single witnesses; the
+	collation comes out at about the density of a real one.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAXPAR 3
+#define MAXFAM 26
+#define dimof(a) (sizeof a/sizeof a[0])
+
+#define new(n,type) malloc((n) * sizeof (type))
+
+typedef struct gen Gen;
+struct gen {
+	int nWit, nUnits, nPars, pctCorr, nFam, pctLac, pctWgt;
+	int *family;				// Family of each witness (or -1)
+	int *corrected;				// Hands beyond the first
+	int *lacuna;				// Verses left in its lacuna (0 for none)
+	FILE *fp;
+};
+
+static unsigned long Seed = 1;
+
+// A small and portable generator, so a seed gives the same collation anywhere
+static unsigned
+	rnd(unsigned n)
+{
+	Seed = Seed * 6364136223846793005ul + 1442695040888963407ul;
+	return (unsigned) (Seed >> 33) % n;
+}
+
+static int
+	pct(int p)
+{
+	return (int) rnd(100) < p;
+}
+
+static void
+	header(Gen *g, char *chron)
+{
+	FILE *fpChron;
+	int ww, pp, ff, hh;
+
+	fprintf(g->fp, "*");
+	for (ww = 0; ww < g->nWit; ww++)
+		fprintf(g->fp, " w%d", ww);
+	for (pp = 0; pp < g->nPars; pp++)
+		fprintf(g->fp, " /%c", 'a' + pp);
+	fprintf(g->fp, " ;\n^ %s\n", chron);
+
+	fpChron = fopen(chron, "w");
+	if (!fpChron) {
+		perror(chron);
+		exit(1);
+	}
+	for (ww = 0; ww < g->nWit; ww++) {
+		int year = 150 + rnd(1350);
+
+		fprintf(fpChron, "w%d %d %d %d\n", ww, year, year + 25, year + 50 + rnd(100));
+		for (hh = 1; hh <= g->corrected[ww]; hh++) {
+			year += 50 + rnd(300);
+			fprintf(fpChron, "w%d:%d %d %d %d\n", ww, hh, year, year + 25, year + 50);
+		}
+	}
+	fclose(fpChron);
+
+	// The families are defined in each parallel, as macros are per parallel
+	for (pp = 0; pp < ((g->nPars) ? g->nPars : 1); pp++) {
+		if (g->nPars)
+			fprintf(g->fp, "/%c\n", 'a' + pp);
+		for (ff = 0; ff < g->nFam; ff++) {
+			int n = 0;
+
+			fprintf(g->fp, "= $%c", 'A' + ff);
+			for (ww = 0; ww < g->nWit; ww++) {
+				if (g->family[ww] == ff) {
+					fprintf(g->fp, " w%d", ww);
+					n++;
+				}
+			}
+			if (n == 0)
+				fprintf(g->fp, " w%d", ff % g->nWit);
+			fprintf(g->fp, " ;\n");
+		}
+	}
+}
+
+// States of a piece of nUnits, each reading within nRdgs
+static void
+	states(Gen *g, int nUnits, int *nRdgs, int base)
+{
+	int vv;
+
+	putc(' ', g->fp);
+	for (vv = 0; vv < nUnits; vv++)
+		putc((base < 0) ? '0' + (int) rnd(nRdgs[vv] + 1) : '0' + base % (nRdgs[vv] + 1), g->fp);
+}
+
+static void
+	piece(Gen *g, int nUnits, int pp)
+{
+	static char *words[] = { "kai", "o", "theos", "logos", "en", "arche", "de", "ego", "eimi", "ton" };
+	int nRdgs[8], vv, ww, ff, rr;
+	int fam1 = (g->nFam) ? rnd(g->nFam) : -1, fam2 = (g->nFam > 1) ? rnd(g->nFam) : -1;
+
+	fprintf(g->fp, "[");
+	for (ww = rnd(4); ww >= 0; ww--)
+		fprintf(g->fp, " %s", words[rnd(dimof(words))]);
+	for (vv = 0; vv < nUnits; vv++) {
+		if (!pct(g->pctWgt))
+			fprintf(g->fp, " |");
+		else if (rnd(2))
+			fprintf(g->fp, " |*%d", 2 + rnd(3));
+		else
+			fprintf(g->fp, " |%d", 2 + rnd(12));
+		nRdgs[vv] = 1 + rnd(3);
+		for (rr = 1; rr <= nRdgs[vv]; rr++)
+			fprintf(g->fp, " %d=%s", rr, words[rnd(dimof(words))]);
+	}
+	fprintf(g->fp, " ]\n<");
+
+	// The majority, a family or two, and some singletons
+	states(g, nUnits, nRdgs, 0);
+	fprintf(g->fp, " $*");
+	for (ff = 0; ff < 2; ff++) {
+		int fam = (ff == 0) ? fam1 : fam2;
+		if (fam < 0 || (ff == 1 && (fam == fam1 || rnd(2))))
+			continue;
+		fprintf(g->fp, " |");
+		states(g, nUnits, nRdgs, 1 + ff);
+		fprintf(g->fp, " $%c", 'A' + fam);
+	}
+	for (ww = 0; ww < g->nWit; ww++) {
+		if ((pp == 0 && g->lacuna[ww]) || !pct(3))
+			continue;
+		fprintf(g->fp, " |");
+		states(g, nUnits, nRdgs, -1);
+		fprintf(g->fp, " w%d", ww);
+		if (g->corrected[ww] && pct(30)) {
+			fprintf(g->fp, " |");
+			states(g, nUnits, nRdgs, -1);
+			fprintf(g->fp, " w%d:%d", ww, 1 + rnd(g->corrected[ww]));
+		}
+	}
+	fprintf(g->fp, " >\n");
+}
+
+static void
+	collation(Gen *g)
+{
+	int units = 0, verse = 0, pp, ww;
+
+	while (units < g->nUnits) {
+		int nPieces = 1 + rnd(4), pc, nn[4];
+
+		for (pc = 0; pc < nPieces; pc++) {
+			nn[pc] = 1 + rnd(3);
+			if (units + nn[pc] > g->nUnits)
+				nn[pc] = g->nUnits - units;
+			units += nn[pc];
+			if (nn[pc] == 0)
+				nPieces = pc;
+		}
+
+		fprintf(g->fp, "@ V%d\n", verse++);
+		if (g->nPars)
+			fprintf(g->fp, "/a\n");
+
+		// Lacunae are in the first parallel (where the % commands are)
+		for (ww = 0; ww < g->nWit; ww++) {
+			if (g->lacuna[ww] && --g->lacuna[ww] == 0)
+				fprintf(g->fp, "%%+ w%d ;\n", ww);
+			else if (!g->lacuna[ww] && pct(g->pctLac) && rnd(50) == 0) {
+				g->lacuna[ww] = 2 + rnd(20);
+				fprintf(g->fp, "%%- w%d ;\n", ww);
+			}
+		}
+
+		for (pp = 0; pp < ((g->nPars) ? g->nPars : 1); pp++) {
+			if (pp > 0)
+				fprintf(g->fp, "/%c\n", 'a' + pp);
+			for (pc = 0; pc < nPieces; pc++)
+				piece(g, nn[pc], pp);
+		}
+	}
+}
+
+int
+	main(int argc, char *argv[])
+{
+	Gen g[1];
+	char *chron;
+	int opt, ww;
+
+	g->nWit = 200;
+	g->nUnits = 10000;
+	g->nPars = 0;
+	g->pctCorr = 10;
+	g->nFam = 8;
+	g->pctLac = 10;
+	g->pctWgt = 10;
+	while ((opt = getopt(argc, argv, "w:u:p:c:m:l:x:s:")) != -1) {
+		switch (opt) {
+		case 'w': g->nWit = atoi(optarg); break;
+		case 'u': g->nUnits = atoi(optarg); break;
+		case 'p': g->nPars = atoi(optarg); break;
+		case 'c': g->pctCorr = atoi(optarg); break;
+		case 'm': g->nFam = atoi(optarg); break;
+		case 'l': g->pctLac = atoi(optarg); break;
+		case 'x': g->pctWgt = atoi(optarg); break;
+		case 's': Seed = strtoul(optarg, (char **) 0, 0); break;
+		default:
+			fprintf(stderr, "Usage: %s [-w wits] [-u units] [-p pars] [-c corr%%]"
+				" [-m macros] [-l lacunae%%] [-x weighted%%] [-s seed] base\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind != argc-1 || g->nWit < 1 || g->nUnits < 1
+	|| g->nPars < 0 || g->nPars > MAXPAR || g->nFam < 0 || g->nFam > MAXFAM) {
+		fprintf(stderr, "%s: need a base name, and sensible sizes\n", argv[0]);
+		return 2;
+	}
+
+	g->family = new(g->nWit, int);
+	g->corrected = new(g->nWit, int);
+	g->lacuna = new(g->nWit, int);
+	chron = new(strlen(argv[optind]) + 7, char);
+	if (!g->family || !g->corrected || !g->lacuna || !chron)
+		return 1;
+	for (ww = 0; ww < g->nWit; ww++) {
+		g->family[ww] = (g->nFam && pct(60)) ? (int) rnd(g->nFam) : -1;
+		g->corrected[ww] = (pct(g->pctCorr)) ? 1 + rnd(2) : 0;
+		g->lacuna[ww] = 0;
+	}
+
+	sprintf(chron, "%s.chron", argv[optind]);
+	if (!(g->fp = fopen(argv[optind], "w"))) {
+		perror(argv[optind]);
+		return 1;
+	}
+	header(g, chron);
+	collation(g);
+	fclose(g->fp);
+	return 0;
+}
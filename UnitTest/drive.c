@@ -0,0 +1,94 @@
+/*
+	drive - Prepare a collation through libprep, writing the .tx or the
+	.no as prep would from what prepHands(), prepWeights() and
+	prepPreceding() give, for the Makefile to compare with the goldens.
+
+	Usage: drive collation tx|no
+
+	The settings are FRAG=1 and CORR=1, as the Makefile runs prep with.
+*/
+#include <stdio.h>
+#include <string.h>
+
+#include "libprep.h"
+
+static int nBad;				// Pairs prepBefore() has wrong
+
+static void
+	writeTx(Prep *p)
+{
+	const PrepHand *hands;
+	const int *wgts;
+	int nHands, nUnits, wvar = 0, hh, uu, ww;
+
+	hands = prepHands(p, &nHands);
+	wgts = prepWeights(p, &nUnits);
+	for (uu = 0; uu < nUnits; uu++)
+		wvar += (wgts[uu] > 0) ? wgts[uu] : 0;
+	printf("%-9d %d\n", nHands, wvar);
+	for (hh = 0; hh < nHands; hh++) {
+		printf("%-9s ", hands[hh].name);
+		for (uu = 0; uu < nUnits; uu++) {
+			for (ww = 0; ww < wgts[uu]; ww++)
+				putchar(hands[hh].row[uu]);
+		}
+		putchar('\n');
+	}
+}
+
+// Each hand's line lists those before it, with itself in its place
+static void
+	writeNo(Prep *p)
+{
+	const PrepHand *hands;
+	const int *before;
+	int nHands, nBefore, hh, ii;
+
+	hands = prepHands(p, &nHands);
+	for (hh = 0; hh < nHands; hh++) {
+		before = prepPreceding(p, hh, &nBefore);
+		printf("%-9s %4d < ", hands[hh].name, hands[hh].stratum);
+		for (ii = 0; ii < nBefore && before[ii] < hh; ii++)
+			printf("%s ", hands[before[ii]].name);
+		printf("%s ", hands[hh].name);
+		for ( ; ii < nBefore; ii++)
+			printf("%s ", hands[before[ii]].name);
+		printf(">\n");
+
+		// prepBefore() must say the same of every pair
+		for (ii = 0; ii < nHands; ii++) {
+			int listed = 0, jj;
+
+			for (jj = 0; jj < nBefore; jj++)
+				listed |= (before[jj] == ii);
+			if (prepBefore(p, ii, hh) != listed) {
+				fprintf(stderr, "prepBefore(%d, %d) is not as listed\n", ii, hh);
+				nBad++;
+			}
+		}
+	}
+}
+
+int
+	main(int argc, char *argv[])
+{
+	PrepSettings settings;
+	Prep *p;
+
+	if (argc != 3 || (strcmp(argv[2], "tx") != 0 && strcmp(argv[2], "no") != 0)) {
+		fprintf(stderr, "Usage: %s collation tx|no\n", argv[0]);
+		return 2;
+	}
+	if (!(p = prepParse(argv[1], (char **) 0, stderr)))
+		return 1;
+	memset(&settings, 0, sizeof settings);
+	settings.frag = "1";
+	settings.corr = "1";
+	prepSuppress(p, &settings);
+	if (strcmp(argv[2], "tx") == 0)
+		writeTx(p);
+	else
+		writeNo(p);
+	prepFree(p);
+	return (nBad > 0);
+}
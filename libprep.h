@@ -0,0 +1,65 @@
+
+/*
+	libprep - prep as a library (libprep.a), to hand its matrix to a
+	program such as stemma in memory, instead of through the files.
+
+	A collation is parsed once, by prepParse(), and can then be
+	suppressed as often as wanted, each time with its own settings and
+	from the parse as it was.  After prepSuppress(), prepHands() has the
+	active hands, in the order of the .tx, with their rows of the
+	resolved matrix and their dates, prepWeights() the weight of each
+	unit (0 for those suppressed), and prepPreceding() the hands that
+	come before each, as the .no has them; all of it is good until the
+	next prepSuppress() or prepFree().
+
+	ROOT, WEIGHBYED, AUTOED and CACHE are taken from the environment by the
+	parse, as for the command.  YEARGRAN is a setting of the whole
+	process, so runs that differ in it must not overlap.
+*/
+
+typedef struct context Prep;
+
+// What the environment gives the command (NULL or 0 for the default)
+typedef struct prepSettings PrepSettings;
+struct prepSettings {
+	char *frag;					// FRAG, e.g. "50%" or "12"
+	char *corr;					// CORR
+	char *year;					// YEAR cut-off
+	int noSing;					// NOSING
+	int idOk;					// IDOK, to keep identical witnesses
+	int yearGran;				// YEARGRAN (-1 for the N.T. table)
+	int jobs;					// Threads for the passes, as -j
+};
+
+// An active hand, as of the last prepSuppress()
+typedef struct prepHand PrepHand;
+struct prepHand {
+	const char *name;			// As in the .tx and .no
+	const char *row;			// Its state in each unit
+	int stratum;				// As in the .no
+	int earliest, latest;		// Its dates (INT_MAX if none)
+	int parallel, witness, hand;
+};
+
+// Parse collation, with the witnesses mandated (NULL-terminated, or
+// NULL), warning on fpErr (NULL for stderr); NULL if it will not do.
+Prep *prepParse(char *collation, char **witnesses, FILE *fpErr);
+
+// Suppress as the command would with settings; returns the hands active.
+int prepSuppress(Prep *p, const PrepSettings *settings);
+
+const PrepHand *prepHands(Prep *p, int *nHands);
+const int *prepWeights(Prep *p, int *nUnits);
+
+// The hands (as indices into prepHands()) that come before hand h:
+// those whose latest year is before its earliest, and its own earlier
+// hands.  Its .no line lists the same, in the same order, and h itself.
+const int *prepPreceding(Prep *p, int h, int *nPreceding);
+
+// Does hand a come before hand b (of prepHands())?  Never for a == b.
+int prepBefore(Prep *p, int a, int b);
+
+void prepFree(Prep *p);
+
+// The command itself
+int prepMain(int argc, char *argv[]);
@@ -4,11 +4,17 @@
 
 	Usage: prep collation {taxa}*
 
+	Also built as a library, libprep.a (see libprep.h).  With --watch,
+	stays resident, preparing again whenever the collation or one of
+	its Chron files changes.
+
 	In files:
-		collation - collation information for the MSS
+		collation - collation information for the MSS ("-" for stdin)
 
 	Out files:
 		matrix    - the matrix of taxa and variants (*.tx)
+		binary    - ... and its dates, if TXB is set (*.txb)
+		distances - agreements of each pair of hands, if DM (*.dm)
 		strat     - stratigraphical constraints     (*.no)
 		variants  - listing of each variant         (*.vr)
 
@@ -21,6 +27,16 @@
 					for including corrected witnesses.  (10%)
 		YEAR      - Cut off year for witnesses.
 		NOSING    - No singular readings in matrix.
+		COMPACTTX - Write each distinct column of the matrix once,
+					with its weight; the .vr numbers units by it.
+		COMPACTNO - Give each hand's years in the .no, instead of
+					the hands dated before it.
+		TXB       - Also write the matrix and dates in binary (*.txb).
+		DM        - Also write the agreements of each pair of hands (*.dm).
+		AUTOED    - Weigh each plain unit by the word edit-distance
+					of its readings from the lemma words they replace
+					(for a/b, of b from a), in bins of AUTOED
+					words (WEIGHBYED, default 6, bins the |n units).
 		ROOT      - Define an explicit root/ancestor (e.g. UBS).
 
 	Special macros:
@@ -30,10 +46,32 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <limits.h>
 #include <assert.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+// AVX2 kernels are built whatever the CFLAGS, and run if the CPU has it
+#if defined(__SSE2__) && defined(__GNUC__)
+#define AVX2 __attribute__((target("avx2")))
+#define hasAVX2() __builtin_cpu_supports("avx2")
+#endif
+#include "libprep.h"
 #include "prep.h"
 
 /* Tokens:
@@ -60,6 +98,7 @@
 	|	- separator
 	>	- End Witness
 	-	- suppress witness
+	&	- pool witnesses into one
 	:	- corrector
 	;	- list terminator for *, =, etc.
 	+   - eat lists until terminator.
@@ -70,6 +109,7 @@
 #define NOMSS (-1)
 #define SUPPRESSED (-2)
 #define BADHAND (-3)
+#define NOLINE ((unsigned long) -1)
 
 #define CVT '~'					// Convert separator
 
@@ -78,6 +118,9 @@
 #define LITGRAN (-1)			// Literary Granularity, use table
 static int YearGran = 0;		// Default to no granularity
 
+static Chron *Chrons;			// Chron files loaded, for the process
+static pthread_mutex_t ChronLock = PTHREAD_MUTEX_INITIALIZER;
+
 #define FTHRESHOLD "50%"
 #define CTHRESHOLD "10%"
 #define WEIGHBYED 6
@@ -85,10 +128,23 @@ static int YearGran = 0;		// Default to no granularity
 typedef enum { OK, WARN, END, FATAL, } Status;
 
 #define EAT(ctx, t, u)     while ((t = getToken(ctx)) && *t != u)
-
+#define SKIM(ctx, t, u)    while ((t = scanToken(ctx)) && *t != u)
+
+static int loadMss(Context *ctx);
+static void *growArray(void *a, int *max, int need, size_t sz);
+static void *arenaAlloc(Arena *a, size_t n);
+static char *arenaStr(Arena *a, const char *s);
+static void freeArena(Arena *a);
+static void adoptArena(Arena *a, Arena *from);
+static char *intern(Context *ctx, const char *s, size_t len);
+static void rewindMss(Context *ctx);
 static char *getToken(Context *ctx);
 static Macro *getMacro(Context *ctx, char *token);
+static Macro *newMacro(Context *ctx);
+static int nextBit(const uint64_t *bits, int nWords, int from);
+static void indexMSS(Context *ctx);
 static int findMSS(Context *ctx, char *name, int *hh);
+static int findAland(Context *ctx, char *name, int *hh);
 static int findPar(Context *ctx, int code);
 static char *parName(Context *ctx, int pp, int corrected, int hh, char *name);
 static char *append(char *src, char *end, char *dst);
@@ -96,15 +152,72 @@ static void fWarn(Context *ctx, char *cmd, char *msg, char *arg);
 static int activeMSS(Context *ctx);
 #define EOFWARN(ctx, cmd) fWarn(ctx, cmd, "Unexpected end of file", "")
 
+static char *handSet(Hand *hands, int hh, int pc);
+static void correctorSet(Hand *h, int pc, char *rdgs);
+static char *resolveSet(Hand *hands, int hh, int pc);
+static void assignSet(Context *ctx, int ms, int hh, char *rdgs);
+static void buildMatrix(Context *ctx);
+static void poolMss(Context *ctx);
+static uint64_t hashBytes(const char *p, size_t n);
+static int compactColumns(Context *ctx, const int *rows, int nRows, int *patVar, int *patWgt);
 static void writeTx(Context *ctx);
 static void writeNo(Context *ctx);
 static void writeVr(Context *ctx);
+static void writeTxb(Context *ctx);
+static void writeDm(Context *ctx);
+static void startPhase(double t[2]);
+static void endPhase(Context *ctx, const char *name, double t[2]);
+static void noteBytes(Context *ctx);
+static void addCounts(Counts *to, const Counts *from);
+static void writeStats(Context *ctx);
+static FILE *outFile(char *base, char *ext);
+static FILE *openOutput(Context *ctx, int ii, char *ext);
 static void mandateTx(Context *ctx);
 static void suppressTx(Context *ctx);
 static void suppressVr(Context *ctx);
 static void suppressId(Context *ctx);
-
+static int nShares(Context *ctx, int n);
+static void shareOut(Context *ctx, int lo, int hi, void (*fn)(Share *), void *arg);
+static void suppress(Context *ctx, double t[2]);
+static void process(Context *ctx);
+static void sweep(Context *ctx);
+static int addSweep(Context *ctx, char *arg);
+static char *setting(Context *ctx, char *name);
+static int caching(Context *ctx);
+static int readCache(Context *ctx);
+static char *commandToken(Context *ctx);
+static int openBlocks(Context *ctx);
+static int markBlock(Context *ctx, char *token);
+static void endBlock(Context *ctx);
+static void noteState(Context *ctx, int cmd, size_t from);
+static void noteAssign(Context *ctx, int ms, int hh, char *rdgs);
+static void noteHand(Context *ctx, int ms, int all);
+static void writeBlocks(Context *ctx);
+static int useChunk(Context *ctx);
+static void endChunks(Context *ctx);
+static void writeCache(Context *ctx);
+static void growVars(Context *ctx, int var);
+static void growSets(Context *ctx, int set);
+static void growPieces(Context *ctx, int piece);
+static void initParallel(Context *ctx, Parallel *p, int name);
+static void runGroups(Context *ctx);
+static int addGroup(Context *ctx, char *arg);
+static void addToGroup(Context *ctx, char *arg);
+
+static int run(int argc, char *argv[], Watch *w);
+static int watchMss(int argc, char *argv[]);
+static void addWatch(Watch *w, char *fn);
+static void closeOutputs(Context *ctx, int done);
+static Status parseMss(Context *ctx, double t[2], int *nWarn);
+static Status command(Context *ctx, char *token);
+static int setRange(Context *ctx, char *arg);
+static Status startRange(Context *ctx, int *nWarn);
+static Status endRange(Context *ctx, int *nWarn);
+static char *optValue(int argc, char *argv[], int *ii);
 static int initContext(Context *ctx, int argc, char *argv[]);
+static int openCollation(Context *ctx, char *base);
+static void startContext(Context *ctx);
+static FILE *outFile(char *base, char *ext);
 static Status doMSS(Context *ctx);
 static Status doParallel(Context *ctx);
 static Status doDefine(Context *ctx);
@@ -113,144 +226,347 @@ static Status doVerse(Context *ctx);
 static Status doReadings(Context *ctx);
 static Status doWitnesses(Context *ctx);
 static Status doChron(Context *ctx);
+static Chron *loadChron(Context *ctx, char *fn);
+static void stampFile(char *fn, uint64_t stamp[3]);
 static Status doSuppress(Context *ctx);
+static Status doPool(Context *ctx);
+static void poolSrc(Context *ctx, int ms, int hh);
 static Status doComment(Context *ctx);
 static Status doAlias(Context *ctx);
 static Status doEat(Context *ctx);
 
+static void noteVr(Context *ctx);
 static Status vrVerse(Context *ctx);
 static Status vrReadings(Context *ctx);
 
 static int litStratum(int year);
 
+#ifdef LIBPREP
+#define main prepMain
+#endif
+
 int
 	main(int argc, char *argv[])
+{
+	int ii;
+
+	for (ii = 1; ii < argc; ii++) {
+		if (strcmp(argv[ii], "--watch") == 0) {
+			memmove(&argv[ii], &argv[ii+1], (argc - ii) * sizeof (char *));
+			return watchMss(argc - 1, argv);
+		}
+	}
+	return run(argc, argv, (Watch *) 0);
+}
+
+// One run of the command, noting in w (if any) the files it read
+static int
+	run(int argc, char *argv[], Watch *w)
 {
 	Status status = OK;
-	char *token;
-	static Context ctx[1];
-	int nWarn = 0;
+	Context *ctx = calloc(1, sizeof (Context));
+	int nWarn = 0, done = NO, ii;
 	char *yearGran;
+	double t[2];
 
-	if (!initContext(ctx, argc, argv))
+	assert( ctx );
+	ctx->watching = (w != (Watch *) 0);
+	startPhase(t);
+	if (!initContext(ctx, argc, argv)) {
+		prepFree(ctx);
 		return -2;
+	}
 
 	if ((yearGran = getenv("YEARGRAN")))
 		YearGran = atoi(yearGran);
 
-	ctx->token_lineno = ctx->lineno;
-	while ((token = getToken(ctx))) {
-		switch (*token) {
-		default:
-			fWarn(ctx, "?", "Unknown token:", token);
-			status = WARN;
-			break;
-		case '!':		// User requested end
-			status = END;
-			break;
-		case '*':
-			status = doMSS(ctx);
-			break;
-		case '/':
-			status = doParallel(ctx);
-			break;
-		case '=':
-			status = doDefine(ctx);
-			break;
-		case '%':
-			status = doLacuna(ctx);
-			break;
-		case '@':
-			status = doVerse(ctx);
-			break;
-		case '[':
-			status = doReadings(ctx);
-			break;
-		case '<':
-			status = doWitnesses(ctx);
-			break;
-		case '~':
-			status = doAlias(ctx);
-			break;
-		case '^':
+	status = parseMss(ctx, t, &nWarn);
+	for (ii = 0; w && ii < ctx->nChron; ii++)
+		addWatch(w, ctx->chronFiles[ii]);
+	printf("Parallels=%d; MSS=%d; VarUnits=%d; Pieces=%d; Sets=%d\n",
+		ctx->nParallels, ctx->nMSS, ctx->nVar, ctx->nPiece, ctx->nSets);
+
+	if (status == FATAL)
+		fprintf(stderr, "Fatal error, terminating ...\n");
+	else if (ctx->nMSS == 0) {
+		fprintf(stderr, "No witnesses, terminating...\n");
+		status = FATAL;
+	} else if (nWarn == 0) {
+		if (ctx->nGroups)
+			runGroups(ctx);
+		else {
+			startPhase(t);
+			mandateTx(ctx);
+			endPhase(ctx, "mandateTx", t);
+			if (ctx->nSweep)
+				sweep(ctx);
+			else
+				process(ctx);
+		}
+		done = YES;
+	} else
+		fprintf(stderr, "Too many warnings, terminating ...\n");
+
+	if (!ctx->nSweep && !ctx->nGroups) {
+		noteBytes(ctx);
+		closeOutputs(ctx, done);
+	}
+	writeStats(ctx);
+	prepFree(ctx);
+	return (status != OK && status != END) ? -status : nWarn;
+}
+
+// Parse the top-level command token.
+static Status
+	command(Context *ctx, char *token)
+{
+	Status status = OK;
+
+	switch (*token) {
+	default:
+		fWarn(ctx, "?", "Unknown token:", token);
+		status = WARN;
+		break;
+	case '!':		// User requested end
+		status = END;
+		break;
+	case '*':
+		status = doMSS(ctx);
+		break;
+	case '/':
+		status = doParallel(ctx);
+		break;
+	case '=':
+		status = doDefine(ctx);
+		break;
+	case '%':
+		status = doLacuna(ctx);
+		break;
+	case '@':
+		status = doVerse(ctx);
+		break;
+	case '[':
+		status = doReadings(ctx);
+		break;
+	case '<':
+		status = doWitnesses(ctx);
+		break;
+	case '~':
+		status = doAlias(ctx);
+		break;
+	case '^':
+		{
+			double tc[2];
+
+			startPhase(tc);
 			status = doChron(ctx);
-			break;
-		case '-':
-			status = doSuppress(ctx);
-			break;
-		case '"':
-			status = doComment(ctx);
-			break;
-		case '+':
-			status = doEat(ctx);
-		case '{':
-		case '}':
-			// Ignore
+			endPhase(ctx, "doChron", tc);
+		}
+		break;
+	case '-':
+		status = doSuppress(ctx);
+		break;
+	case '&':
+		status = doPool(ctx);
+		break;
+	case '"':
+		status = doComment(ctx);
+		break;
+	case '+':
+		status = doEat(ctx);
+	case '{':
+	case '}':
+		// Ignore
+		status = OK;
+		break;
+	}
+
+	return status;
+}
+
+/*
+	Parse the collation (or take it from the cache), counting the
+	commands that warned in *nWarn; t is the phase under way.
+*/
+static Status
+	parseMss(Context *ctx, double t[2], int *nWarn)
+{
+	Status status = OK;
+	char *token;
+	int cached;
+
+	ctx->token_lineno = ctx->lineno;
+	cached = readCache(ctx);
+	if (!cached)
+		openBlocks(ctx);
+	endPhase(ctx, "cache", t);
+	if (ctx->rangeFrom && !cached)
+		status = startRange(ctx, nWarn);
+	while (!cached && status != END && status != FATAL) {
+		size_t from;
+		int cmd;
+
+		// Splice in what a worker made of the next chunk (-j)
+		if (ctx->nJobs > 1 && !ctx->blocks && useChunk(ctx)) {
 			status = OK;
+			continue;
+		}
+		if (!(token = commandToken(ctx)))
 			break;
+		from = ctx->tokp - ctx->mssBuf;
+		cmd = *token;
+
+		// Reuse an unchanged @ block from the last parse
+		if (markBlock(ctx, token)) {
+			status = OK;
+			continue;
+		}
+		status = command(ctx, token);
+		if (strchr("*=%~^-&", cmd)) {
+			noteState(ctx, cmd, from);
+			if (cmd != '%')
+				endChunks(ctx);
 		}
 		if (status == END || status == FATAL)
 			break;
 		if (status == WARN)
-			nWarn++;
+			++*nWarn;
+	}
+	endBlock(ctx);
+	endChunks(ctx);
+	if (ctx->rangeFrom && !cached && status != END && status != FATAL)
+		status = endRange(ctx, nWarn);
+	endPhase(ctx, "parse", t);
+
+	ctx->nVar = ctx->var;
+	ctx->nPiece = ctx->piece + 1;
+	ctx->nSets = ctx->set;
+	if (!cached && status != FATAL && *nWarn == 0 && ctx->nWarned == 0 && ctx->nMSS > 0) {
+		writeCache(ctx);
+		writeBlocks(ctx);
 	}
 
-	if (status == FATAL)
-		fprintf(stderr, "Fatal error, terminating ...\n");
-	else if (nWarn == 0) {
-		mandateTx(ctx);
-		suppressVr(ctx);
-		suppressTx(ctx);
-		suppressVr(ctx);
-		if (!getenv("IDOK"))
-			suppressId(ctx);
-		writeTx(ctx);
-		writeNo(ctx);
-		writeVr(ctx);
-	} else
-		fprintf(stderr, "Too many warnings, terminating ...\n");
+	// The cache has the parse before the & commands, which are done afresh
+	if (ctx->nPools && status != FATAL && *nWarn == 0 && ctx->nWarned == 0) {
+		poolMss(ctx);
+		endPhase(ctx, "poolMss", t);
+	}
+	return status;
+}
 
-	fclose(ctx->fpVr);
-	fclose(ctx->fpTx);
-	fclose(ctx->fpMss);
-	return (status != OK && status != END) ? -status : nWarn;
+// White space, as isspace() has it in the C locale
+static const char IsSpace[256] = {
+	['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1, [' '] = 1,
+};
+
+// Map (or, for pipes and the like, read) the whole collation into mssBuf.
+static int
+	loadMss(Context *ctx)
+{
+	struct stat sb;
+	int fd = fileno(ctx->fpMss);
+	size_t max;
+	ssize_t nn;
+
+	ctx->mssBuf = (char *) 0;
+	ctx->mssLen = ctx->mssPos = 0;
+	ctx->mssMapped = NO;
+
+	if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode)) {
+		if (sb.st_size == 0)
+			return YES;
+		ctx->mssBuf = mmap(0, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ctx->mssBuf != MAP_FAILED) {
+			ctx->mssLen = sb.st_size;
+			ctx->mssMapped = YES;
+			return YES;
+		}
+		ctx->mssBuf = (char *) 0;
+	}
+
+	// Not mappable, so read it in blocks.
+	max = 1 << 16;
+	ctx->mssBuf = new(max, char);
+	assert( ctx->mssBuf );
+	while ((nn = read(fd, ctx->mssBuf + ctx->mssLen, max - ctx->mssLen)) > 0) {
+		ctx->mssLen += nn;
+		if (ctx->mssLen == max) {
+			max *= 2;
+			ctx->mssBuf = realloc(ctx->mssBuf, max);
+			assert( ctx->mssBuf );
+		}
+	}
+	return (nn == 0) ? YES : NO;
+}
+
+static void
+	rewindMss(Context *ctx)
+{
+	ctx->mssPos = 0;
+	ctx->lineno = 0;
+	ctx->inc_line_p = YES;
 }
 
+// Move past the next token, leaving it (unterminated) in tokp and
+// toklen; NULL at the end.  As getToken(), without copying it out.
 static char *
-	getToken(Context *ctx)
+	scanToken(Context *ctx)
 {
-	char *s;
-	int ch;
+	const unsigned char *p, *end, *tok;
+	size_t len;
 
 	if (ctx->inc_line_p) {
 		ctx->lineno++;
 		ctx->inc_line_p = NO;
 	}
 
+	p = (unsigned char *) ctx->mssBuf + ctx->mssPos;
+	end = (unsigned char *) ctx->mssBuf + ctx->mssLen;
+
 	// Skip initial white space
-	while ((ch = fgetc(ctx->fpMss)) != EOF && isspace(ch)) {
-		if (ch == '\n')
+	while (p < end && IsSpace[*p]) {
+		if (*p++ == '\n')
 			ctx->lineno++;
-		continue;
 	}
-	if (ch == EOF)
+	if (p == end) {
+		ctx->mssPos = ctx->mssLen;
 		return (char *) 0;
+	}
 
-	// Collect chars for token
-	s = ctx->token;
-	do {
-		if (s == &ctx->token[MAXTOKEN-1]) {
-			fprintf(stderr, "WARN: Max token size (%d) exceeded: %s\n",
-				MAXTOKEN, ctx->token);
-			break;
-		}
-		*s++ = ch;
-	} while ((ch = fgetc(ctx->fpMss)) != EOF && !isspace(ch));
+	// Find the extent of the token
+	tok = p;
+	while (p < end && !IsSpace[*p])
+		p++;
+	len = p - tok;
+
+	if (len > MAXTOKEN-1) {
+		len = MAXTOKEN-1;
+		memcpy(ctx->token, tok, len);
+		ctx->token[len] = EOS;
+		fprintf(ctx->fpErr, "WARN: Max token size (%d) exceeded: %s\n",
+			MAXTOKEN, ctx->token);
+		ctx->nWarned++;
+		p = tok + len + 1;		// The overflowing char is dropped
+	} else if (p < end) {
+		if (*p == '\n')
+			ctx->inc_line_p = YES;
+		p++;					// Consume the terminating white space
+	}
+	ctx->mssPos = p - (unsigned char *) ctx->mssBuf;
 
-	if (ch == '\n')
-		ctx->inc_line_p = YES;
+	ctx->tokp = (char *) tok;
+	ctx->toklen = len;
+	return ctx->tokp;
+}
 
-	*s = EOS;
+static char *
+	getToken(Context *ctx)
+{
+	if (!scanToken(ctx))
+		return (char *) 0;
+	ctx->counts.tokens++;
+	memcpy(ctx->token, ctx->tokp, ctx->toklen);
+	ctx->token[ctx->toklen] = EOS;
 	return ctx->token;
 }
 
@@ -264,14 +580,121 @@ static Macro *
 		fWarn(ctx, "<", "Out-of-range macro (could be Greek):", token);
 		return 0;
 	}
+	if (ctx->par[ctx->parallel].pMacros[name])
+		ctx->counts.macros++;
 	return ctx->par[ctx->parallel].pMacros[name];
 }
 
+static unsigned
+	hashName(const char *name)
+{
+	unsigned hash = 2166136261u;	// FNV-1a
+
+	while (*name) {
+		hash ^= (unsigned char) *name++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Insert ms into an open-addressed index; the earliest witness wins a name.
+static int
+	indexInsert(Context *ctx, int *index, int ms, char *name, int byAland)
+{
+	unsigned slot = hashName(name) & ctx->mssMask;
+	int m2;
+
+	while ((m2 = index[slot]) != NOMSS) {
+		if (strcmp(name, (byAland) ? ctx->mss[m2].Aland : ctx->mss[m2].name) == 0)
+			return m2;
+		slot = (slot + 1) & ctx->mssMask;
+	}
+	index[slot] = ms;
+	return ms;
+}
+
+static void
+	indexAland(Context *ctx)
+{
+	int *last;
+	int ms, m2;
+
+	for (ms = 0; ms <= ctx->mssMask; ms++)
+		ctx->alandIndex[ms] = NOMSS;
+
+	// Chain witnesses sharing an Aland name, in ascending order.
+	last = new(ctx->nMSS, int);
+	assert( last );
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		ctx->alandNext[ms] = NOMSS;
+		m2 = indexInsert(ctx, ctx->alandIndex, ms, ctx->mss[ms].Aland, YES);
+		if (m2 != ms)
+			ctx->alandNext[last[m2]] = ms;
+		last[m2] = ms;
+	}
+	free(last);
+	ctx->alandStale = NO;
+}
+
+// Build the witness indexes, once the witnesses are all declared.
+static void
+	indexMSS(Context *ctx)
+{
+	int ms, slots = 16;
+
+	while (slots < 2 * ctx->nMSS)
+		slots *= 2;
+	ctx->mssMask = slots - 1;
+
+	ctx->nameIndex = new(slots, int);
+	ctx->alandIndex = new(slots, int);
+	ctx->alandNext = new(ctx->nMSS, int);
+	assert( ctx->nameIndex && ctx->alandIndex && ctx->alandNext );
+
+	for (ms = 0; ms < slots; ms++)
+		ctx->nameIndex[ms] = NOMSS;
+	for (ms = 0; ms < ctx->nMSS; ms++)
+		indexInsert(ctx, ctx->nameIndex, ms, ctx->mss[ms].name, NO);
+	indexAland(ctx);
+}
+
+static Macro *
+	newMacro(Context *ctx)
+{
+	Macro *macro = new(1, Macro);
+
+	assert( macro );
+	macro->level = ctx->macLevel++;
+	macro->inset = calloc(ctx->macWords, sizeof (uint64_t));
+	assert( macro->inset );
+	return macro;
+}
+
+// Index of the first set bit at or after from, or -1.
+static int
+	nextBit(const uint64_t *bits, int nWords, int from)
+{
+	int ww = from >> 6;
+	uint64_t word;
+
+	if (ww >= nWords)
+		return -1;
+	word = bits[ww] & (~(uint64_t) 0 << (from & 63));
+	while (!word) {
+		if (++ww == nWords)
+			return -1;
+		word = bits[ww];
+	}
+	return (ww << 6) + __builtin_ctzll(word);
+}
+
 static int
 	findMSS(Context *ctx, char *name, int *hh)
 {
 	int ms, status;
 	char *dot, *colon, *tick;
+
+	ctx->counts.findMSS++;
 	dot = strchr(name, '.');
 	colon = strchr(name, ':');
 	tick = strchr(name, '\'');
@@ -295,11 +718,14 @@ static int
 	}
 
 	status = NOMSS;
-	for (ms = 0; ms < ctx->nMSS; ms++) {
-		register Witness *w = &ctx->mss[ms];
-		if (strcmp(name, w->name) == 0) {
-			status = ms;
-			break;
+	if (ctx->nameIndex) {
+		unsigned slot = hashName(name) & ctx->mssMask;
+		while ((ms = ctx->nameIndex[slot]) != NOMSS) {
+			if (strcmp(name, ctx->mss[ms].name) == 0) {
+				status = ms;
+				break;
+			}
+			slot = (slot + 1) & ctx->mssMask;
 		}
 	}
 
@@ -325,7 +751,7 @@ static char *
 	parName(Context *ctx, int pp, int corrected, int hh, char *name)
 {
 	int code;
-	static char buf[MAXTOKEN];
+	static __thread char buf[MAXTOKEN];
 	char *b = buf;
 
 	b += sprintf(buf, "%s", name);
@@ -358,21 +784,22 @@ static void
 {
 	int col;
 
-	col = fprintf(stderr, "%4lu: %s (%4lu)", ctx->lineno, cmd, ctx->token_lineno);
-	do { col += fprintf(stderr, " "); } while (col < 6);
+	ctx->nWarned++;
+	col = fprintf(ctx->fpErr, "%4lu: %s (%4lu)", ctx->lineno, cmd, ctx->token_lineno);
+	do { col += fprintf(ctx->fpErr, " "); } while (col < 6);
 
-	col += fprintf(stderr, "%s", msg);
+	col += fprintf(ctx->fpErr, "%s", msg);
 	if (*arg)
-		col += fprintf(stderr, " %s", arg);
-	do { col += fprintf(stderr, " "); } while (col < 31);
+		col += fprintf(ctx->fpErr, " %s", arg);
+	do { col += fprintf(ctx->fpErr, " "); } while (col < 31);
 
-	col += fprintf(stderr, "@ %s", ctx->par[ctx->parallel].position);
-	do { col += fprintf(stderr, " "); } while (col < 50);
+	col += fprintf(ctx->fpErr, "@ %s", ctx->par[ctx->parallel].position);
+	do { col += fprintf(ctx->fpErr, " "); } while (col < 50);
 
 	if (*ctx->lemma != EOS)
-		fprintf(stderr, "[ %s ]", ctx->lemma);
+		fprintf(ctx->fpErr, "[ %s ]", ctx->lemma);
 
-	fprintf(stderr, "\n");
+	fprintf(ctx->fpErr, "\n");
 }
 
 // activeMSS() - return the number of active (non-suppressed) witnesses
@@ -395,13 +822,16 @@ static int
 }
 
 
+// Find the first witness with Gregory-Aland name; alandNext[] has the rest.
 static int
-	findAland(Context *ctx, char *name, int *hh, int ms)
+	findAland(Context *ctx, char *name, int *hh)
 {
 	char *colon = strchr(name, ':');
+	unsigned slot;
+	int ms, status = NOMSS;
 
-	if (ms >= ctx->nMSS)
-		return ms;
+	if (ctx->alandStale)
+		indexAland(ctx);
 
 	if (colon) {
 		*hh = atoi(colon+1);
@@ -409,15 +839,19 @@ static int
 	} else
 		*hh = 0;
 
-	do {
-		if (strcmp(name, ctx->mss[ms].Aland) == 0)
+	slot = hashName(name) & ctx->mssMask;
+	while ((ms = ctx->alandIndex[slot]) != NOMSS) {
+		if (strcmp(name, ctx->mss[ms].Aland) == 0) {
+			status = ms;
 			break;
-	} while (++ms < ctx->nMSS);
+		}
+		slot = (slot + 1) & ctx->mssMask;
+	}
 
 	if (colon)
 		*colon = ':';
 
-	return ms;
+	return status;
 }
 
 // Mandate a command-line selected subset of witnesses
@@ -463,9 +897,8 @@ static void
 				status = WARN;
 				continue;
 			}
-			for (ms = (ctx->Root) ? 1 : 0; ms < ctx->nMSS; ms++) {
-				if (!macro->inset[ms])
-					continue;
+			for (ms = nextBit(macro->inset, ctx->macWords, (ctx->Root) ? 1 : 0);
+					ms >= 0; ms = nextBit(macro->inset, ctx->macWords, ms+1)) {
 				hands = para->msHands[ms];
 				hands[0].mandated = YES;
 			}
@@ -506,25 +939,32 @@ int
 	return thresh;
 }
 
+/*
+	Suppress the fragmentary hands, and the correctors with too little of
+	their own, of witnesses [lo, hi) in every parallel.  What is done is
+	written to fps[job * nParallels + pp], so that each job's part can be
+	put back in the order of a single one.
+*/
 static void
-	suppressTx(Context *ctx)
+	suppressShare(Share *s)
 {
+	Context *ctx = s->ctx;
+	FILE **fps = (FILE **) s->arg;
 	int fThresh, cThresh;
 	int ms, pc, hh, i, nExtant, nCorrs;
 	int pp;
 	int var;
 	char * r;
-	char *yearenv;
-	int year, lastHand, nHands;
+	int lastHand, nHands;
 
-	fThresh = threshold(getenv("FRAG"), ctx->wvar, FTHRESHOLD);
-	cThresh = threshold(getenv("CORR"), ctx->wvar, CTHRESHOLD);
-	fprintf(stderr, "Thresholds: frag=%d, corr=%d; adjustments:", fThresh, cThresh);
+	fThresh = threshold(setting(ctx, "FRAG"), ctx->wvar, FTHRESHOLD);
+	cThresh = threshold(setting(ctx, "CORR"), ctx->wvar, CTHRESHOLD);
 
 	for (pp = 0; pp < ctx->nParallels; pp++)
-	for (ms = 0; ms < ctx->nMSS; ms++) {
+	for (ms = s->lo; ms < s->hi; ms++) {
 		register Witness *w = &ctx->mss[ms];
 		register Hand *hands = ctx->par[pp].msHands[ms];
+		FILE *fp = fps[s->job * ctx->nParallels + pp];
 		int isSuppressed;
 
 		/* Skip already suppressed witnesses (if all hands are suppressed) */
@@ -536,55 +976,39 @@ static void
 		if (isSuppressed == YES)
 			continue;
 
-		/* Count active variation units */
-		nExtant = 0;
-		var = 0;
-		for (pc = 0; pc < ctx->nPiece; pc++) {
-			if (!hands[0].sets[pc]) {
-				var += ctx->pieceUnits[pc];
-				continue;
-			}
-			r = hands[0].sets[pc];
-			for (i = 0; r[i]; i++) {
-				if (r[i] != MISSING)
-					nExtant += ctx->wgts[var];
-				var++;
-			}
-		}
+		/* Active variation units, as counted during the parse */
+		nExtant = hands[0].nExtant;
 		if ((!ctx->Root || ms > 0) && (nExtant < fThresh) && !hands[0].mandated) {
 			hands[0].suppressed = YES;
-			fprintf(stderr, " -%s(%d)",
+			fprintf(fp, " -%s(%d)",
 				parName(ctx, pp, NO, 0, w->name), nExtant);
 		}
 
 		lastHand = 0;
 		for (hh = 1; hh < MAXHAND; hh++) {
 			nCorrs = 0;
-			var = 0;
-			for (pc = 0; pc < ctx->nPiece; pc++) {
+			for (i = 0; i < hands[hh].nPcs; i++) {
 				char *lh;
-				if (!hands[hh].sets[pc]) {
-					hands[hh].sets[pc] = hands[lastHand].sets[pc];
-					var += ctx->pieceUnits[pc];
-					continue;
-				}
-				r = hands[hh].sets[pc];
-				lh = hands[lastHand].sets[pc];
-				for (i = 0; r[i]; i++) {
-					char lhRdg = (lh) ? lh[i] : MISSING;	// Default to MISSING for hands in $?
-					if (r[i] != lhRdg)
+				int nn;
+
+				pc = hands[hh].pcs[i];
+				r = hands[hh].pcSets[i];
+				lh = resolveSet(hands, lastHand, pc);
+				var = ctx->pieceVar[pc];
+				for (nn = 0; nn < ctx->pieceUnits[pc]; nn++, var++) {
+					char lhRdg = (lh) ? lh[nn] : MISSING;	// Default to MISSING for hands in $?
+					if (r[nn] != lhRdg)
 						nCorrs += ctx->wgts[var];
-					var++;
 				}
 			}
 			if ((nCorrs < cThresh) && !hands[hh].mandated) {
 				hands[hh].suppressed = YES;
 				if (nCorrs > cThresh/2)
-					fprintf(stderr, " -%s(%d)", parName(ctx, pp, YES, hh, w->name), nCorrs);
+					fprintf(fp, " -%s(%d)", parName(ctx, pp, YES, hh, w->name), nCorrs);
 			} else {
 				hands[hh].lastHand = lastHand;
 				lastHand = hh;
-				fprintf(stderr, " +%s(%d)",
+				fprintf(fp, " +%s(%d)",
 					parName(ctx, pp, w->corrected, hh, w->name), nCorrs);
 			}
 		}
@@ -597,14 +1021,50 @@ static void
 		}
 		w->corrected = (nHands > 1) ? YES : NO;
 	}
-	fprintf(stderr, "\n");
+}
+
+static void
+	suppressTx(Context *ctx)
+{
+	int fThresh, cThresh;
+	int ms, pp, hh, jj;
+	char *yearenv;
+	int year;
+	int nJobs = nShares(ctx, ctx->nMSS), nFps = nJobs * ctx->nParallels;
+	FILE **fps = new(nFps + 1, FILE *);
+	char **bufs = new(nFps + 1, char *);
+	size_t *lens = new(nFps + 1, size_t);
+
+	fThresh = threshold(setting(ctx, "FRAG"), ctx->wvar, FTHRESHOLD);
+	cThresh = threshold(setting(ctx, "CORR"), ctx->wvar, CTHRESHOLD);
+	fprintf(ctx->fpErr, "Thresholds: frag=%d, corr=%d; adjustments:", fThresh, cThresh);
+
+	// The jobs each have witnesses of their own, in every parallel
+	assert( fps && bufs && lens );
+	for (jj = 0; jj < nFps; jj++) {
+		fps[jj] = (nJobs > 1) ? open_memstream(&bufs[jj], &lens[jj]) : ctx->fpErr;
+		assert( fps[jj] );
+	}
+	shareOut(ctx, 0, ctx->nMSS, suppressShare, fps);
+	for (pp = 0; pp < ctx->nParallels && nJobs > 1; pp++) {
+		for (jj = 0; jj < nJobs; jj++) {
+			int ff = jj * ctx->nParallels + pp;
+			fclose(fps[ff]);
+			fwrite(bufs[ff], 1, lens[ff], ctx->fpErr);
+			free(bufs[ff]);
+		}
+	}
+	free(fps);
+	free(bufs);
+	free(lens);
+	fprintf(ctx->fpErr, "\n");
 	
 	// Suppress by year
-	if ((yearenv = getenv("YEAR")) == 0)
+	if ((yearenv = setting(ctx, "YEAR")) == 0)
 		return;
 	year = atoi(yearenv);
 	
-	fprintf(stderr, "Year suppression at %d:", year);
+	fprintf(ctx->fpErr, "Year suppression at %d:", year);
 	for (pp = 0; pp < ctx->nParallels; pp++)
 	for (ms = 0; ms < ctx->nMSS; ms++) {
 		register Witness *w = &ctx->mss[ms];
@@ -615,159 +1075,901 @@ static void
 				continue;
 			if ((hands[hh].earliest > year) && !hands[hh].mandated) {
 				hands[hh].suppressed = YES;
-				fprintf(stderr, " -%s(%d)",
+				fprintf(ctx->fpErr, " -%s(%d)",
 					parName(ctx, pp, w->corrected, hh, w->name), hands[hh].earliest);
 			}
 		}
 	}
-	fprintf(stderr, "\n");
+	fprintf(ctx->fpErr, "\n");
 }
 
-// Suppress constant variants
+/* ------------------------------------------------------
+||
+||  Resolved state matrix
+||
+*/
+
+/*
+	The readings hand hh has of its own for piece pc, or NULL.  Hand 0
+	has them by piece; a corrector only for the pieces in its pcs, which
+	are in order.
+*/
+static char *
+	handSet(Hand *hands, int hh, int pc)
+{
+	Hand *h = &hands[hh];
+	int lo = 0, hi = h->nPcs;
+
+	if (hh == 0)
+		return h->sets[pc];
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (h->pcs[mid] < pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < h->nPcs && h->pcs[lo] == pc) ? h->pcSets[lo] : (char *) 0;
+}
 
+// Give corrector h the readings rdgs for piece pc, the last it has any for.
 static void
-	suppressVr(Context *ctx)
+	correctorSet(Hand *h, int pc, char *rdgs)
 {
-	int ms, pp, hh, pc, pv, var;
-	char *r;
-	int state;
+	if (h->nPcs == 0 || h->pcs[h->nPcs-1] != pc) {
+		int max = h->maxPcs;
 
-	var = 0;
-	for (pc = 0; pc < ctx->nPiece; pc++) {
-		for (pv = 0; pv < ctx->pieceUnits[pc]; pv++) {
-			static unsigned char states[256];	// States attested among kids
-			static int count[256];			// Count of corresponding state
-			int ss, nStates=0; 				// Number of different states
-			int dblCount=0;					// Count for the twice attested
+		assert( h->nPcs == 0 || h->pcs[h->nPcs-1] < pc );
+		h->pcSets = growArray(h->pcSets, &max, h->nPcs+1, sizeof (char *));
+		h->pcs = growArray(h->pcs, &h->maxPcs, h->nPcs+1, sizeof (int));
+		h->pcs[h->nPcs++] = pc;
+	}
+	h->pcSets[h->nPcs-1] = rdgs;
+}
 
-			for (pp = 0; pp < ctx->nParallels; pp++)
-			for (ms = 0; ms < ctx->nMSS; ms++) {
-				register Hand *hands = ctx->par[pp].msHands[ms];
-				int defchar = (ctx->Root && pp == 00 && ms == 0)
-					? '0' : MISSING;
-
-				for (hh = 0; hh < MAXHAND; hh++) {
-					if (hands[hh].suppressed)
-						continue;
-					r = hands[hh].sets[pc];
-					if (!r && hh > 0)
-						r = hands[hands[hh].lastHand].sets[pc];
-					state = (r) ? r[pv] : defchar;
-
-					if (state == MISSING)
-						continue;
-
-					// Find state index, adjust count if found, else add one
-					for (ss = 0; ss < nStates; ss++) {
-						if (states[ss] == state)
-							break;
-					}
-					if (ss < nStates) {
-						count[ss]++;
-						if (count[ss] == 2)
-							dblCount++;
-					} else {
-						ss = nStates++;
-						states[ss] = state;
-						count[ss] = 1;
-					}
-				}
-			}
+// The readings of hand hh for piece pc, inherited from previous hands
+// (which end with hand 0) if it has none of its own.
+static char *
+	resolveSet(Hand *hands, int hh, int pc)
+{
+	char *r = handSet(hands, hh, pc);
 
-			// Suppress this variation if we're same/constant.
-			if (nStates <= 1
-			|| (getenv("NOSING") && dblCount <= 1)) {
-				ctx->wvar -= ctx->wgts[var];
-				ctx->wgts[var] = 0;
-			}
-			var++;
-		}
+	while (!r && hh > 0) {
+		hh = hands[hh].lastHand;
+		r = handSet(hands, hh, pc);
 	}
+	return r;
 }
 
-// Suppress identical witnesses
-
+/*
+	Resolve the states of one hand into row, as the .tx file will have
+	them:  hand 0's, then those of each corrector back along the chain
+	of lastHand from hh, the nearest last.
+*/
 static void
-	suppressId(Context *ctx)
+	resolveRow(Context *ctx, int pp, int ms, int hh, char *row)
 {
-	int pp, ms;
+	Hand *hands = ctx->par[pp].msHands[ms];
+	int defchar = (ctx->Root && pp == 0 && ms == 0) ? '0' : MISSING;
+	int chain[MAXHAND];
+	int pc, nn, ii, nChain = 0;
+	char *r = row;
 
-	fprintf(stderr, "Checking identical witnesses:");
+	for (pc = 0; pc < ctx->nPiece; pc++) {
+		nn = ctx->pieceUnits[pc];
+		if (hands[0].sets[pc])
+			memcpy(r, hands[0].sets[pc], nn);
+		else
+			memset(r, defchar, nn);
+		r += nn;
+	}
 
-	for (pp = 0; pp < ctx->nParallels; pp++)
-	for (ms = 0; ms < ctx->nMSS; ms++) {
-		register Witness *w = &ctx->mss[ms];
-		register Hand *hands = ctx->par[pp].msHands[ms];
-		int m2;
+	for ( ; hh > 0 && nChain < MAXHAND; hh = hands[hh].lastHand)
+		chain[nChain++] = hh;
+	while (nChain-- > 0) {
+		Hand *h = &hands[chain[nChain]];
+		for (ii = 0; ii < h->nPcs; ii++) {
+			pc = h->pcs[ii];
+			if (h->pcSets[ii])
+				memcpy(&row[ctx->pieceVar[pc]], h->pcSets[ii], ctx->pieceUnits[pc]);
+		}
+	}
+}
 
-		if (hands[0].suppressed)
-			continue;
-		for (m2 = 0; m2 < ms; m2++) {
-			register Witness *w2 = &ctx->mss[m2];
-			register Hand *hand2 = ctx->par[pp].msHands[m2];
-			int pc;
+static int
+	hasReadings(Context *ctx, Hand *hands, int hh)
+{
+	int pc;
 
-			if (hand2[0].suppressed)
-				continue;
-			for (pc = 0; pc < ctx->nPiece; pc++) {
-				if (hands[0].sets[pc] != hand2[0].sets[pc])
-					break;
-			}
-			if (pc == ctx->nPiece) {
-				hands[0].suppressed = YES;
-				fprintf(stderr, " -%s=%s", w->name, w2->name);
-				break;
-			}
-		}
+	if (hh > 0)
+		return hands[hh].nPcs > 0;
+	for (pc = 0; pc < ctx->nPiece; pc++) {
+		if (hands[0].sets[pc])
+			return YES;
 	}
-	fprintf(stderr, " Done\n");
+	return NO;
 }
 
+// Resolve rows [lo, hi) of the matrix, from the (pp, ms, hh) of each
 static void
-	writeTx(Context *ctx)
+	resolveShare(Share *s)
 {
-	int ms, pp, hh, pc, pv, vv, var;
-	int nActive = activeMSS(ctx);
+	Context *ctx = s->ctx;
+	const int *of = (const int *) s->arg;
+	int rr;
 
-	// Output
-	printf("Year granularity: %d\n", YearGran);
-	printf("Active witnesses: %d, weighted variants: %d\n", nActive, ctx->wvar);
-	printf("Witnesses:");
+	for (rr = s->lo; rr < s->hi; rr++)
+		resolveRow(ctx, of[3*rr], of[3*rr+1], of[3*rr+2], &ctx->mat.rows[rr * ctx->nVar]);
+}
 
-	fprintf(ctx->fpTx, "%-9d %d\n", nActive, ctx->wvar);
-	for (pp = 0; pp < ctx->nParallels; pp++)
-	for (ms = 0; ms < ctx->nMSS; ms++) {
-		register Witness *w = &ctx->mss[ms];
-		register Hand *hands = ctx->par[pp].msHands[ms];
-		int defchar = (ctx->Root && pp == 0 && ms == 0) ? '0' : MISSING;
+// Columns [lo, hi) of the tally, from the row each of its rows is
+static void
+	tallyShare(Share *s)
+{
+	Matrix *mat = &s->ctx->mat;
+	const int *rowOf = (const int *) s->arg;
+	int tt, var;
+
+	for (tt = 0; tt < mat->nTally; tt++) {
+		char *row = &mat->rows[rowOf[tt] * mat->nCols];
+		for (var = s->lo; var < s->hi; var++)
+			mat->cols[var * mat->nTally + tt] = row[var];
+	}
+}
+
+/*
+	Build a row for every hand that is not suppressed.  A corrector
+	without readings of its own just repeats a previous hand, so it
+	shares that hand's row.  The column tally has each row in use once,
+	or twice if more than one active hand shares it; suppressVr() only
+	ever asks whether a state is attested once or more than once.  The
+	rows are laid out first, then resolved and tallied by the jobs.
+*/
+static void
+	buildMatrix(Context *ctx)
+{
+	Matrix *mat = &ctx->mat;
+	int pp, ms, hh, rr, tt;
+	int maxRows = 0;
+	int *tally, *of, *rowOf;
+
+	free(mat->rows);
+	free(mat->cols);
+	mat->rows = (char *) 0;
+	mat->nRows = 0;
+	mat->nCols = ctx->nVar;
+
+	tally = of = (int *) 0;
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Hand *hands = ctx->par[pp].msHands[ms];
+		int nActive = 0;
 
 		for (hh = 0; hh < MAXHAND; hh++) {
-			if (hands[hh].suppressed)
+			hands[hh].row = -1;
+			if (!hands[hh].suppressed)
+				nActive++;
+		}
+		if (nActive == 0)
+			continue;
+
+		for (hh = 0; hh < MAXHAND; hh++) {
+			int from = hands[hh].lastHand;
+
+			if (hh > 0 && hands[hh].suppressed)
+				continue;
+			if (hh > 0 && hands[from].row >= 0 && !hasReadings(ctx, hands, hh))
+				hands[hh].row = hands[from].row;
+			else {
+				if (mat->nRows == maxRows) {
+					int old = maxRows;
+					tally = growArray(tally, &old, mat->nRows+1, sizeof (int));
+					old = maxRows;
+					of = growArray(of, &old, mat->nRows+1, 3 * sizeof (int));
+					mat->rows = growArray(mat->rows, &maxRows, mat->nRows+1,
+						ctx->nVar ? ctx->nVar : 1);
+				}
+				hands[hh].row = mat->nRows++;
+				tally[hands[hh].row] = 0;
+				of[3 * hands[hh].row] = pp;
+				of[3 * hands[hh].row + 1] = ms;
+				of[3 * hands[hh].row + 2] = hh;
+			}
+			if (!hands[hh].suppressed)
+				tally[hands[hh].row]++;
+		}
+	}
+	shareOut(ctx, 0, mat->nRows, resolveShare, of);
+
+	// Column-major tally
+	mat->nTally = 0;
+	for (rr = 0; rr < mat->nRows; rr++)
+		mat->nTally += (tally[rr] > 2) ? 2 : tally[rr];
+	mat->cols = new(mat->nTally * ctx->nVar + 1, char);
+	rowOf = new(mat->nTally + 1, int);
+	assert( mat->cols && rowOf );
+	tt = 0;
+	for (rr = 0; rr < mat->nRows; rr++) {
+		int copy;
+		for (copy = 0; copy < tally[rr] && copy < 2; copy++)
+			rowOf[tt++] = rr;
+	}
+	shareOut(ctx, 0, ctx->nVar, tallyShare, rowOf);
+	free(rowOf);
+	free(of);
+	free(tally);
+}
+
+/*
+	Row kernel for poolMss():  pool the states of src into acc.  Where
+	they agree, or src is MISSING, acc stands; where acc is MISSING, it
+	takes src's; elsewhere the two clash, and acc is CLASH from then on.
+	A vector at a time (by AVX2 if the CPU has it, then SSE2 or NEON),
+	and the ragged end by the scalar loop.
+*/
+#define CLASH '\001'
+
+#if defined(AVX2)
+// The AVX2 loop of poolRow(), up to the last whole vector; where it stopped.
+AVX2 static int
+	poolAVX2(char *acc, const char *src, int n)
+{
+	const __m256i miss = _mm256_set1_epi8(MISSING), clash = _mm256_set1_epi8(CLASH);
+	int ii = 0;
+
+	for ( ; ii + 32 <= n; ii += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (acc + ii));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (src + ii));
+		__m256i keep = _mm256_or_si256(_mm256_cmpeq_epi8(a, b), _mm256_cmpeq_epi8(b, miss));
+		__m256i take = _mm256_andnot_si256(keep, _mm256_cmpeq_epi8(a, miss));
+		__m256i r = _mm256_blendv_epi8(_mm256_blendv_epi8(clash, a, keep), b, take);
+
+		_mm256_storeu_si256((__m256i *) (acc + ii), r);
+	}
+	return ii;
+}
+#endif
+
+static void
+	poolRow(char *acc, const char *src, int n)
+{
+	int ii = 0;
+
+#if defined(AVX2)
+	if (hasAVX2())
+		ii = poolAVX2(acc, src, n);
+#endif
+#if defined(__SSE2__)
+	{
+		const __m128i miss = _mm_set1_epi8(MISSING), clash = _mm_set1_epi8(CLASH);
+
+		for ( ; ii + 16 <= n; ii += 16) {
+			__m128i a = _mm_loadu_si128((const __m128i *) (acc + ii));
+			__m128i b = _mm_loadu_si128((const __m128i *) (src + ii));
+			__m128i keep = _mm_or_si128(_mm_cmpeq_epi8(a, b), _mm_cmpeq_epi8(b, miss));
+			__m128i take = _mm_andnot_si128(keep, _mm_cmpeq_epi8(a, miss));
+			__m128i r = _mm_or_si128(_mm_and_si128(keep, a), _mm_and_si128(take, b));
+
+			r = _mm_or_si128(r, _mm_andnot_si128(_mm_or_si128(keep, take), clash));
+			_mm_storeu_si128((__m128i *) (acc + ii), r);
+		}
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	{
+		const uint8x16_t miss = vdupq_n_u8(MISSING), clash = vdupq_n_u8(CLASH);
+
+		for ( ; ii + 16 <= n; ii += 16) {
+			uint8x16_t a = vld1q_u8((const uint8_t *) acc + ii);
+			uint8x16_t b = vld1q_u8((const uint8_t *) src + ii);
+			uint8x16_t keep = vorrq_u8(vceqq_u8(a, b), vceqq_u8(b, miss));
+			uint8x16_t take = vbicq_u8(vceqq_u8(a, miss), keep);
+
+			vst1q_u8((uint8_t *) acc + ii, vbslq_u8(take, b, vbslq_u8(keep, a, clash)));
+		}
+	}
+#endif
+
+	for ( ; ii < n; ii++) {
+		if (src[ii] != acc[ii] && src[ii] != MISSING)
+			acc[ii] = (acc[ii] == MISSING) ? src[ii] : CLASH;
+	}
+}
+
+/*
+	The & commands, in order:  each pooled witness takes the joint states
+	of its own readings (if any) and its sources', resolved a row at a
+	time; those that clash are MISSING.  Its readings go back by piece,
+	interned (a source's, mostly) for suppressId(), and its nExtant is
+	counted for the FRAG threshold of suppressTx().  The sources are then
+	suppressed.
+*/
+static void
+	poolMss(Context *ctx)
+{
+	char *pooled = new(2 * ctx->nVar + 1, char), *row = pooled + ctx->nVar;
+	int ii, jj, pc, nn, var;
+
+	assert( pooled );
+	fprintf(ctx->fpErr, "Pooled:");
+	for (ii = 0; ii < ctx->nPools; ii++) {
+		Pool *pool = &ctx->pools[ii];
+		Hand *hands = ctx->par[pool->parallel].msHands[pool->ms];
+		int *src = &ctx->poolSrcs[2 * pool->from];
+
+		// Its own readings are usually none (it is in lacuna from the &)
+		if (hasReadings(ctx, hands, 0) || (ctx->Root && pool->parallel == 0 && pool->ms == 0))
+			resolveRow(ctx, pool->parallel, pool->ms, 0, pooled);
+		else
+			memset(pooled, MISSING, ctx->nVar);
+		for (jj = 0; jj < pool->nSrcs; jj++) {
+			resolveRow(ctx, pool->parallel, src[2*jj], (src[2*jj+1] < 0) ? 0 : src[2*jj+1], row);
+			poolRow(pooled, row, ctx->nVar);
+		}
+
+		hands[0].nExtant = 0;
+		for (pc = 0, var = 0; pc < ctx->nPiece; pc++) {
+			char *r = &pooled[var];
+			int any = NO;
+
+			for (nn = 0; nn < ctx->pieceUnits[pc]; nn++, var++) {
+				if (pooled[var] == CLASH)
+					pooled[var] = MISSING;
+				if (pooled[var] != MISSING) {
+					hands[0].nExtant += ctx->wgts[var];
+					any = YES;
+				}
+			}
+
+			// Mostly the readings of a source, so already interned
+			hands[0].sets[pc] = (char *) 0;
+			for (jj = 0; any && jj < pool->nSrcs; jj++) {
+				Hand *h = ctx->par[pool->parallel].msHands[src[2*jj]];
+				char *set = resolveSet(h, (src[2*jj+1] < 0) ? 0 : src[2*jj+1], pc);
+
+				if (set && memcmp(set, r, nn) == 0) {
+					hands[0].sets[pc] = set;
+					break;
+				}
+			}
+			if (any && !hands[0].sets[pc])
+				hands[0].sets[pc] = intern(ctx, r, nn);
+		}
+
+		for (jj = 0; jj < pool->nSrcs; jj++) {
+			Hand *h = ctx->par[pool->parallel].msHands[src[2*jj]];
+			int hh;
+
+			for (hh = 0; hh < MAXHAND; hh++) {
+				if (src[2*jj+1] < 0 || src[2*jj+1] == hh)
+					h[hh].suppressed = YES;
+			}
+		}
+		fprintf(ctx->fpErr, " %s(%d)",
+			parName(ctx, pool->parallel, NO, 0, ctx->mss[pool->ms].name), hands[0].nExtant);
+	}
+	fprintf(ctx->fpErr, "\n");
+	free(pooled);
+}
+
+/*
+	Column kernel for suppressVr():  count the different states attested
+	in a column of the tally, ignoring MISSING, and how many of those are
+	attested more than once.  Counts saturate, since only one versus more
+	than one matters.  The sixteen states from WINLO ('-', '.', '/', the
+	digits, ':', ';' and '<') are counted a vector at a time (by AVX2 if
+	the CPU has it, then SSE2 or NEON); any other states and the ragged
+	end of the column go through the scalar counts.
+*/
+#define WINLO '-'
+
+#if defined(AVX2)
+// The AVX2 loop of tallyColumn(), up to the last whole vector; where it stopped.
+AVX2 static int
+	tallyAVX2(const unsigned char *col, int n, unsigned *count)
+{
+	const __m256i lo = _mm256_set1_epi8(WINLO), one = _mm256_set1_epi8(1);
+	const __m256i top = _mm256_set1_epi8(15), miss = _mm256_set1_epi8(MISSING);
+	__m256i acc[16];
+	int ii = 0, ss;
+
+	for (ss = 0; ss < 16; ss++)
+		acc[ss] = _mm256_setzero_si256();
+	for ( ; ii + 32 <= n; ii += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) (col + ii));
+		__m256i x = _mm256_sub_epi8(v, lo);
+		__m256i in = _mm256_cmpeq_epi8(_mm256_min_epu8(x, top), x);
+		unsigned out = ~(unsigned) _mm256_movemask_epi8(
+			_mm256_or_si256(in, _mm256_cmpeq_epi8(v, miss)));
+
+		for (ss = 0; ss < 16; ss++) {
+			__m256i eq = _mm256_cmpeq_epi8(x, _mm256_set1_epi8(ss));
+			acc[ss] = _mm256_adds_epu8(acc[ss], _mm256_and_si256(eq, one));
+		}
+		for ( ; out; out &= out - 1)
+			count[col[ii + __builtin_ctz(out)]]++;
+	}
+	for (ss = 0; ss < 16; ss++) {
+		__m256i sum = _mm256_sad_epu8(acc[ss], _mm256_setzero_si256());
+		count[WINLO + ss] += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1)
+			+ _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3);
+	}
+	return ii;
+}
+#endif
+
+static void
+	tallyColumn(const unsigned char *col, int n, int *nStates, int *dblCount)
+{
+	unsigned count[256];
+	int ii = 0, ss;
+
+	memset(count, 0, sizeof count);
+
+#if defined(AVX2)
+	if (n >= 32 && hasAVX2())
+		ii = tallyAVX2(col, n, count);
+#endif
+#if defined(__SSE2__)
+	if (n - ii >= 16) {
+		const __m128i lo = _mm_set1_epi8(WINLO), one = _mm_set1_epi8(1);
+		const __m128i top = _mm_set1_epi8(15), miss = _mm_set1_epi8(MISSING);
+		__m128i acc[16];
+
+		for (ss = 0; ss < 16; ss++)
+			acc[ss] = _mm_setzero_si128();
+		for ( ; ii + 16 <= n; ii += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i *) (col + ii));
+			__m128i x = _mm_sub_epi8(v, lo);
+			__m128i in = _mm_cmpeq_epi8(_mm_min_epu8(x, top), x);
+			unsigned out = ~_mm_movemask_epi8(_mm_or_si128(in, _mm_cmpeq_epi8(v, miss))) & 0xFFFF;
+
+			for (ss = 0; ss < 16; ss++) {
+				__m128i eq = _mm_cmpeq_epi8(x, _mm_set1_epi8(ss));
+				acc[ss] = _mm_adds_epu8(acc[ss], _mm_and_si128(eq, one));
+			}
+			for ( ; out; out &= out - 1)
+				count[col[ii + __builtin_ctz(out)]]++;
+		}
+		for (ss = 0; ss < 16; ss++) {
+			__m128i sum = _mm_sad_epu8(acc[ss], _mm_setzero_si128());
+			count[WINLO + ss] += _mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+		}
+	}
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+	if (n >= 16) {
+		const uint8x16_t lo = vdupq_n_u8(WINLO), one = vdupq_n_u8(1);
+		const uint8x16_t top = vdupq_n_u8(15), miss = vdupq_n_u8(MISSING);
+		uint8x16_t acc[16];
+
+		for (ss = 0; ss < 16; ss++)
+			acc[ss] = vdupq_n_u8(0);
+		for ( ; ii + 16 <= n; ii += 16) {
+			uint8x16_t v = vld1q_u8(col + ii);
+			uint8x16_t x = vsubq_u8(v, lo);
+			uint8x16_t out = vmvnq_u8(vorrq_u8(vcleq_u8(x, top), vceqq_u8(v, miss)));
+
+			for (ss = 0; ss < 16; ss++)
+				acc[ss] = vqaddq_u8(acc[ss], vandq_u8(vceqq_u8(x, vdupq_n_u8(ss)), one));
+			if (vmaxvq_u8(out)) {
+				uint8_t lanes[16];
+				int ll;
+				vst1q_u8(lanes, out);
+				for (ll = 0; ll < 16; ll++) {
+					if (lanes[ll])
+						count[col[ii + ll]]++;
+				}
+			}
+		}
+		for (ss = 0; ss < 16; ss++)
+			count[WINLO + ss] += vaddlvq_u8(acc[ss]);
+	}
+#endif
+
+	// Scalar fallback, and the tail left by the vector loops.
+	for ( ; ii < n; ii++)
+		count[col[ii]]++;
+
+	*nStates = *dblCount = 0;
+	count[MISSING] = 0;
+	for (ss = 0; ss < 256; ss++) {
+		if (count[ss] > 0)
+			++*nStates;
+		if (count[ss] > 1)
+			++*dblCount;
+	}
+}
+
+// Whether each unit in [lo, hi) is constant, and so to be suppressed.
+static void
+	constantShare(Share *s)
+{
+	Context *ctx = s->ctx;
+	Matrix *mat = &ctx->mat;
+	char *drop = (char *) s->arg;
+	int noSing = setting(ctx, "NOSING") != 0;
+	int var;
+
+	for (var = s->lo; var < s->hi; var++) {
+		int nStates; 					// Number of different states
+		int dblCount;					// Count for the twice attested
+
+		tallyColumn((unsigned char *) &mat->cols[var * mat->nTally], mat->nTally,
+			&nStates, &dblCount);
+
+		// Suppress this variation if we're same/constant.
+		drop[var] = (nStates <= 1 || (noSing && dblCount <= 1));
+	}
+}
+
+// Take the units about to be suppressed (up to a -1) out of the nExtant
+// counts of witnesses [lo, hi), but for ROOT, which is never suppressed
+// as fragmentary.
+static void
+	dropShare(Share *s)
+{
+	Context *ctx = s->ctx;
+	Matrix *mat = &ctx->mat;
+	const int *drop = (const int *) s->arg;
+	int pp, ms, ii;
+
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = s->lo; ms < s->hi; ms++) {
+		Hand *hands = ctx->par[pp].msHands[ms];
+		char *row;
+
+		if (hands[0].row < 0 || (ctx->Root && pp == 0 && ms == 0))
+			continue;
+		row = &mat->rows[hands[0].row * mat->nCols];
+		for (ii = 0; drop[ii] >= 0; ii++) {
+			if (row[drop[ii]] != MISSING)
+				hands[0].nExtant -= ctx->wgts[drop[ii]];
+		}
+	}
+}
+
+// Suppress constant variants
+
+static void
+	suppressVr(Context *ctx)
+{
+	Matrix *mat = &ctx->mat;
+	char *constant = new(mat->nCols + 1, char);
+	int *drop = new(mat->nCols + 1, int);
+	int var, nDrop = 0;
+
+	assert( constant && drop );
+	shareOut(ctx, 0, mat->nCols, constantShare, constant);
+	for (var = 0; var < mat->nCols; var++) {
+		if (constant[var])
+			drop[nDrop++] = var;
+	}
+	drop[nDrop] = -1;
+	if (nDrop > 0)
+		shareOut(ctx, 0, ctx->nMSS, dropShare, drop);
+	for (var = 0; var < nDrop; var++) {
+		ctx->wvar -= ctx->wgts[drop[var]];
+		ctx->wgts[drop[var]] = 0;
+	}
+	free(constant);
+	free(drop);
+}
+
+/*
+	Suppress identical witnesses:  a witness that shares the readings of
+	an earlier active witness in every piece that still has a weighted
+	unit after suppressVr().  Witnesses are bucketed by a hash over those
+	pieces' sets, so only witnesses that collide are compared set by set.
+*/
+
+static unsigned
+	hashSets(char **sets, const int *live, int nLive)
+{
+	unsigned hash = 2166136261u;	// FNV-1a, a pointer at a time
+	int ii;
+
+	for (ii = 0; ii < nLive; ii++) {
+		hash ^= (unsigned) ((uintptr_t) sets[live[ii]] >> 3);
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Hash the live pieces (up to a -1, after the hashes) of witnesses [lo, hi)
+static void
+	hashShare(Share *s)
+{
+	Context *ctx = s->ctx;
+	unsigned *hash = (unsigned *) s->arg;
+	const int *live = (const int *) &hash[ctx->nParallels * ctx->nMSS];
+	int pp, ms, nLive;
+
+	for (nLive = 0; live[nLive] >= 0; nLive++)
+		;
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = s->lo; ms < s->hi; ms++) {
+		Hand *hands = ctx->par[pp].msHands[ms];
+		if (!hands[0].suppressed)
+			hash[pp * ctx->nMSS + ms] = hashSets(hands[0].sets, live, nLive);
+	}
+}
+
+static void
+	suppressId(Context *ctx)
+{
+	int nHash = ctx->nParallels * ctx->nMSS;
+	unsigned *hashes = new(nHash + ctx->nPiece + 1, unsigned);
+	int *live = (int *) &hashes[nHash];
+	int *bucket = new(ctx->mssMask + 1, int);
+	unsigned *bhash = new(ctx->mssMask + 1, unsigned);
+	int pp, ms, pc, var, nLive = 0;
+
+	assert( hashes && bucket && bhash );
+	for (pc = 0, var = 0; pc < ctx->nPiece; pc++) {
+		int nn, wgt = 0;
+		for (nn = 0; nn < ctx->pieceUnits[pc]; nn++)
+			wgt += ctx->wgts[var++];
+		if (wgt > 0)
+			live[nLive++] = pc;
+	}
+	live[nLive] = -1;
+
+	fprintf(ctx->fpErr, "Checking identical witnesses:");
+	shareOut(ctx, 0, ctx->nMSS, hashShare, hashes);
+
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		for (ms = 0; ms <= ctx->mssMask; ms++)
+			bucket[ms] = NOMSS;
+
+		for (ms = 0; ms < ctx->nMSS; ms++) {
+			register Hand *hands = ctx->par[pp].msHands[ms];
+			unsigned hash, slot;
+			int ii;
+
+			if (hands[0].suppressed)
 				continue;
-			fprintf(ctx->fpTx, "%-9s ", parName(ctx, pp, w->corrected, hh, w->pname));
-			printf(" %s", parName(ctx, pp, w->corrected, hh, w->pname));
-			var = 0;
-			for (pc = 0; pc < ctx->nPiece; pc++) {
-				char *r = hands[hh].sets[pc];
-				if (!r && hh > 0)
-					r = hands[hands[hh].lastHand].sets[pc];
-				for (pv = 0; pv < ctx->pieceUnits[pc]; pv++) {
-					for (vv = 0; vv < ctx->wgts[var]; vv++)
-						fputc((r) ? r[pv] : defchar, ctx->fpTx);
-					var++;
+			hash = hashes[pp * ctx->nMSS + ms];
+			for (slot = hash & ctx->mssMask; bucket[slot] != NOMSS;
+					slot = (slot + 1) & ctx->mssMask) {
+				char **sets2 = ctx->par[pp].msHands[bucket[slot]][0].sets;
+
+				if (bhash[slot] != hash)
+					continue;
+				for (ii = 0; ii < nLive; ii++) {
+					if (hands[0].sets[live[ii]] != sets2[live[ii]])
+						break;
 				}
+				if (ii == nLive)
+					break;
+			}
+			if (bucket[slot] != NOMSS) {
+				hands[0].suppressed = YES;
+				fprintf(ctx->fpErr, " -%s=%s", ctx->mss[ms].name, ctx->mss[bucket[slot]].name);
+			} else {
+				bucket[slot] = ms;
+				bhash[slot] = hash;
+			}
+		}
+	}
+	fprintf(ctx->fpErr, " Done\n");
+
+	free(hashes);
+	free(bucket);
+	free(bhash);
+}
+
+/*
+	COMPACTTX:  units whose columns are alike over the active hands (rows
+	in .tx order) go in the .tx once, as a pattern weighted by them all.
+	Returns the number of patterns, each given by its first unit, in
+	patVar, and its weight, in patWgt; ctx->txCol gets the pattern of
+	each unit, to number it by in the .vr.
+*/
+static int
+	compactColumns(Context *ctx, const int *rows, int nRows, int *patVar, int *patWgt)
+{
+	Matrix *mat = &ctx->mat;
+	uint64_t *patHash;
+	int *index, var, ii, nPat = 0;
+	unsigned mask, slot;
+	char *col;
+
+	for (mask = 16; mask < 2 * (unsigned) mat->nCols; mask *= 2)
+		;
+	index = new(mask, int);
+	patHash = new(mat->nCols + 1, uint64_t);
+	col = new(nRows + 1, char);
+	free(ctx->txCol);
+	ctx->txCol = new(mat->nCols + 1, int);
+	assert( index && patHash && col && ctx->txCol );
+	mask--;
+	for (slot = 0; slot <= mask; slot++)
+		index[slot] = -1;
+
+	for (var = 0; var < mat->nCols; var++) {
+		uint64_t hash;
+
+		ctx->txCol[var] = -1;
+		if (ctx->wgts[var] <= 0)
+			continue;
+		for (ii = 0; ii < nRows; ii++)
+			col[ii] = mat->rows[rows[ii] * mat->nCols + var];
+		hash = hashBytes(col, nRows);
+		for (slot = hash & mask; index[slot] >= 0; slot = (slot + 1) & mask) {
+			int pat = index[slot], v2 = patVar[pat];
+
+			if (patHash[pat] != hash)
+				continue;
+			for (ii = 0; ii < nRows; ii++) {
+				if (col[ii] != mat->rows[rows[ii] * mat->nCols + v2])
+					break;
+			}
+			if (ii == nRows)
+				break;
+		}
+		if (index[slot] < 0) {
+			index[slot] = nPat;
+			patHash[nPat] = hash;
+			patVar[nPat] = var;
+			patWgt[nPat++] = 0;
+		}
+		ctx->txCol[var] = index[slot];
+		patWgt[index[slot]] += ctx->wgts[var];
+	}
+	free(col);
+	free(patHash);
+	free(index);
+	return nPat;
+}
+
+/*
+	Write the .tx, a whole row at a time.  The weights are laid out once
+	as runs:  (var, n) copies n units of weight one from var on, and
+	(var, -n) repeats unit var n times.  Rows are built a block of them
+	a job, and the blocks written out in order, a round at a time.
+*/
+#define TXBLOCK (1 << 20)
+
+// Rows [lo, hi) of the .tx, in the job's block
+static void
+	txShare(Share *s)
+{
+	Context *ctx = s->ctx;
+	Lines *ln = (Lines *) s->arg;
+	char *p = ln->out[s->job];
+	int rr, ii;
+
+	for (rr = s->lo; rr < s->hi; rr++) {
+		int pp = ln->hands[3*rr], ms = ln->hands[3*rr+1], hh = ln->hands[3*rr+2];
+		register Witness *w = &ctx->mss[ms];
+		char *row = &ctx->mat.rows[ctx->par[pp].msHands[ms][hh].row * ctx->mat.nCols];
+
+		p += snprintf(p, MAXTOKEN + 1, "%-9s ", parName(ctx, pp, w->corrected, hh, w->pname));
+		for (ii = 0; ii < 2*ln->nRuns; ii += 2) {
+			int n = ln->runs[ii+1];
+
+			if (n > 0) {
+				memcpy(p, &row[ln->runs[ii]], n);
+				p += n;
+			} else {
+				memset(p, row[ln->runs[ii]], -n);
+				p -= n;
 			}
-			fprintf(ctx->fpTx, "\n");
 		}
+		*p++ = '\n';
+	}
+	ln->used[s->job] = p - ln->out[s->job];
+}
+
+static void
+	writeTx(Context *ctx)
+{
+	int ms, pp, hh, var, ii, jj;
+	int nActive = activeMSS(ctx);
+	int *runs, nRuns = 0;
+	int *rows, nRows = 0, *patVar = (int *) 0, *patWgt = (int *) 0, nPat = 0;
+	int compact = setting(ctx, "COMPACTTX") != 0;
+	int nJobs = nShares(ctx, nActive), perJob, rr;
+	size_t lineMax = MAXTOKEN + 2;
+	Lines ln;
+
+	// Output
+	fprintf(ctx->fpOut, "Year granularity: %d\n", YearGran);
+	fprintf(ctx->fpOut, "Active witnesses: %d, weighted variants: %d\n", nActive, ctx->wvar);
+	fprintf(ctx->fpOut, "Witnesses:");
+
+	// The active hands, in order
+	ln.hands = new(3 * nActive + 1, int);
+	rows = new(nActive + 1, int);
+	assert( ln.hands && rows );
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		register Witness *w = &ctx->mss[ms];
+		Hand *hands = ctx->par[pp].msHands[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (hands[hh].suppressed)
+				continue;
+			fprintf(ctx->fpOut, " %s", parName(ctx, pp, w->corrected, hh, w->pname));
+			ln.hands[3*nRows] = pp;
+			ln.hands[3*nRows+1] = ms;
+			ln.hands[3*nRows+2] = hh;
+			rows[nRows++] = hands[hh].row;
+		}
+	}
+	fprintf(ctx->fpOut, "\n");
+
+	free(ctx->txCol);
+	ctx->txCol = (int *) 0;
+	if (compact) {
+		patVar = new(ctx->mat.nCols + 1, int);
+		patWgt = new(ctx->mat.nCols + 1, int);
+		assert( patVar && patWgt );
+		nPat = compactColumns(ctx, rows, nRows, patVar, patWgt);
+
+		// The weights go on a line of their own, after the counts
+		fprintf(ctx->fpTx, "%-9d %d %d\n", nActive, nPat, ctx->wvar);
+		fprintf(ctx->fpTx, "%-9s", "*");
+		for (ii = 0; ii < nPat; ii++)
+			fprintf(ctx->fpTx, " %d", patWgt[ii]);
+		fprintf(ctx->fpTx, "\n");
+	} else
+		fprintf(ctx->fpTx, "%-9d %d\n", nActive, ctx->wvar);
+	free(rows);
+
+	runs = new(2 * ctx->mat.nCols + 2, int);
+	assert( runs );
+	for (ii = 0; ii < ((compact) ? nPat : ctx->mat.nCols); ii++) {
+		int wgt;
+
+		var = (compact) ? patVar[ii] : ii;
+		wgt = (compact) ? 1 : ctx->wgts[var];
+		if (wgt <= 0)
+			continue;
+		if (wgt > 1) {
+			runs[2*nRuns] = var;
+			runs[2*nRuns++ + 1] = -wgt;
+		} else if (nRuns > 0 && runs[2*nRuns-1] > 0
+		&& runs[2*nRuns-2] + runs[2*nRuns-1] == var)
+			runs[2*nRuns-1]++;
+		else {
+			runs[2*nRuns] = var;
+			runs[2*nRuns++ + 1] = 1;
+		}
+		lineMax += wgt;
+	}
+	free(patVar);
+	free(patWgt);
+	ln.runs = runs;
+	ln.nRuns = nRuns;
+
+	// A round is a block of rows a job
+	perJob = (lineMax < TXBLOCK) ? TXBLOCK / lineMax : 1;
+	ln.out = new(nJobs, char *);
+	ln.used = new(nJobs, size_t);
+	assert( ln.out && ln.used );
+	for (jj = 0; jj < nJobs; jj++) {
+		ln.out[jj] = new(perJob * lineMax, char);
+		assert( ln.out[jj] );
+	}
+	for (rr = 0; rr < nRows; rr += nJobs * perJob) {
+		int end = (nRows - rr > nJobs * perJob) ? rr + nJobs * perJob : nRows;
+
+		shareOut(ctx, rr, end, txShare, &ln);
+		for (jj = 0; jj < nShares(ctx, end - rr); jj++)
+			fwrite(ln.out[jj], 1, ln.used[jj], ctx->fpTx);
 	}
-	printf("\n");
+	for (jj = 0; jj < nJobs; jj++)
+		free(ln.out[jj]);
+	free(ln.out);
+	free(ln.used);
+	free(ln.hands);
+	free(runs);
 }
 
 static void
 	stratify(Context *ctx)
 {
 #define MAXYEAR 2050
-	static int strata[MAXYEAR];
+	int strata[MAXYEAR];
 	int stratum;
 	int ms, pp, hh, yr;	
 
@@ -783,7 +1985,9 @@ static void
 				continue;
 			stratum = litStratum(hands[hh].average);
 			hands[hh].stratum = stratum;
-			strata[stratum] = YES;
+			// A late year (YearGran 0 keeps raw years) has no slot
+			if (stratum >= 0 && stratum < MAXYEAR)
+				strata[stratum] = YES;
 		}
 	}
 
@@ -802,20 +2006,87 @@ static void
 		for (hh = 0; hh < MAXHAND; hh++) {
 			if (hands[hh].suppressed)
 				continue;
-			hands[hh].stratum = strata[hands[hh].stratum];
+			if (hands[hh].stratum >= 0 && hands[hh].stratum < MAXYEAR)
+				hands[hh].stratum = strata[hands[hh].stratum];
+		}
+	}
+}
+
+/*
+	Each hand's line in the .no lists the hands that precede it:  those
+	whose latest year is before its earliest, and its own earlier hands.
+	With COMPACTNO, the line gives its earliest and latest years instead
+	of the first lot, as "name stratum earliest latest < ... >", and
+	lists only those of its own hands that the years leave out.
+*/
+static void
+	noLine(Context *ctx, FILE *fp, int pp, int ms, int hh, int compact)
+{
+	register Witness *w = &ctx->mss[ms];
+	register Hand *hands = ctx->par[pp].msHands[ms];
+	int p2, m2, h2;
+
+	fprintf(fp, "%-9s %4d ",
+		parName(ctx, pp, w->corrected, hh, w->pname), hands[hh].stratum);
+	if (compact) {
+		fprintf(fp, "%d %d < ", hands[hh].earliest, hands[hh].latest);
+		for (h2 = 0; h2 <= hh; h2++) {
+			if (!hands[h2].suppressed && hands[hh].earliest <= hands[h2].latest)
+				fprintf(fp, "%s ", parName(ctx, pp, w->corrected, h2, w->pname));
+		}
+		fprintf(fp, ">\n");
+		return;
+	}
+	fprintf(fp, "< ");
+
+	for (p2 = 0; p2 < ctx->nParallels; p2++)
+	for (m2 = 0; m2 < ctx->nMSS; m2++) {
+		register Witness *w2 = &ctx->mss[m2];
+		register Hand *hand2 = ctx->par[p2].msHands[m2];
+		for (h2 = 0; h2 < MAXHAND; h2++) {
+			if (hand2[h2].suppressed)
+				continue;
+			if (hands[hh].earliest > hand2[h2].latest) {
+				fprintf(fp, "%s ",
+					parName(ctx, p2, w2->corrected, h2, w2->pname));
+			} else if (w == w2 && pp == p2 && hh >= h2) {
+				fprintf(fp, "%s ",
+					parName(ctx, p2, w2->corrected, h2, w2->pname));
+			}
 		}
 	}
+	fprintf(fp, ">\n");
+}
+
+// Lines [lo, hi) of the .no, in the job's block
+static void
+	noShare(Share *s)
+{
+	Context *ctx = s->ctx;
+	Lines *ln = (Lines *) s->arg;
+	int compact = setting(ctx, "COMPACTNO") != 0;
+	FILE *fp = open_memstream(&ln->out[s->job], &ln->used[s->job]);
+	int ii;
+
+	assert( fp );
+	for (ii = s->lo; ii < s->hi; ii++)
+		noLine(ctx, fp, ln->hands[3*ii], ln->hands[3*ii+1], ln->hands[3*ii+2], compact);
+	fclose(fp);
 }
 
 static void
 	writeNo(Context *ctx)
 {
-	int pp, p2;
-	int ms, m2;
-	int hh, h2;
+	int pp, ms, hh, jj, ii;
+	int nActive = activeMSS(ctx), nLines = 0, perJob;
+	int nJobs = nShares(ctx, nActive);
+	int compact = setting(ctx, "COMPACTNO") != 0;
+	Lines ln;
 
 	// Output
 	stratify(ctx);
+	ln.hands = new(3 * nActive + 1, int);
+	assert( ln.hands );
 	for (pp = 0; pp < ctx->nParallels; pp++)
 	for (ms = 0; ms < ctx->nMSS; ms++) {
 		register Witness *w = &ctx->mss[ms];
@@ -824,42 +2095,3074 @@ static void
 			if (hands[hh].suppressed)
 				continue;
 			if (hands[hh].latest == INT_MAX && ctx->didChron) {
-				fprintf(stderr, "No chron entry for ");
-				fprintf(stderr, "%s",      parName(ctx, pp, w->corrected, hh, w->name));
-				fprintf(stderr, " ~ %s",   parName(ctx, pp, w->corrected, hh, w->Aland));
-				fprintf(stderr, " ~ %s\n", parName(ctx, pp, w->corrected, hh, w->pname));
-			}
-			fprintf(ctx->fpNo, "%-9s %4d < ",
-				parName(ctx, pp, w->corrected, hh, w->pname), hands[hh].stratum);
-
-			for (p2 = 0; p2 < ctx->nParallels; p2++)
-			for (m2 = 0; m2 < ctx->nMSS; m2++) {
-				register Witness *w2 = &ctx->mss[m2];
-				register Hand *hand2 = ctx->par[p2].msHands[m2];
-				for (h2 = 0; h2 < MAXHAND; h2++) {
-					if (hand2[h2].suppressed)
-						continue;
-					if (hands[hh].earliest > hand2[h2].latest) {
-						fprintf(ctx->fpNo, "%s ",
-							parName(ctx, p2, w2->corrected, h2, w2->pname));
-					} else if (w == w2 && pp == p2 && hh >= h2) {
-						fprintf(ctx->fpNo, "%s ",
-							parName(ctx, p2, w2->corrected, h2, w2->pname));
-					}
-				}
+				fprintf(ctx->fpErr, "No chron entry for ");
+				fprintf(ctx->fpErr, "%s",      parName(ctx, pp, w->corrected, hh, w->name));
+				fprintf(ctx->fpErr, " ~ %s",   parName(ctx, pp, w->corrected, hh, w->Aland));
+				fprintf(ctx->fpErr, " ~ %s\n", parName(ctx, pp, w->corrected, hh, w->pname));
+			}
+			if (nJobs == 1) {
+				noLine(ctx, ctx->fpNo, pp, ms, hh, compact);
+				continue;
 			}
-			fprintf(ctx->fpNo, ">\n");
+			ln.hands[3*nLines] = pp;
+			ln.hands[3*nLines+1] = ms;
+			ln.hands[3*nLines+2] = hh;
+			nLines++;
+		}
+	}
+
+	// With more than one job, a round is a block of lines a job
+	perJob = TXBLOCK / (16 * nActive + 64) + 1;
+	ln.out = new(nJobs, char *);
+	ln.used = new(nJobs, size_t);
+	assert( ln.out && ln.used );
+	for (ii = 0; ii < nLines; ii += nJobs * perJob) {
+		int end = (nLines - ii > nJobs * perJob) ? ii + nJobs * perJob : nLines;
+
+		shareOut(ctx, ii, end, noShare, &ln);
+		for (jj = 0; jj < nShares(ctx, end - ii); jj++) {
+			fwrite(ln.out[jj], 1, ln.used[jj], ctx->fpNo);
+			free(ln.out[jj]);
 		}
 	}
+	free(ln.out);
+	free(ln.used);
+	free(ln.hands);
+}
+
+/*
+	TXB:  base.txb has the matrix of the .tx and the dates of the .no in
+	binary, little-endian, with each part starting on a 64 byte line so
+	that it can be mapped and used as it lies.
+
+	   0  "preptxb1"
+	   8  u32 hands, units, weighted variants, bits a cell (4 or 8),
+	      bytes a row (a multiple of 64), 0
+	  32  u64 offsets of the weights, hands, names and matrix
+	  64  16 bytes, the state of each code when cells are 4 bits
+	 128  weights:  u32 a unit (or COMPACTTX pattern)
+	      hands:  i32 stratum, earliest, latest, parallel, witness,
+	              hand, offset of the name, 0
+	      names:  NUL-terminated
+	      matrix:  a row a hand, as the .tx has them; the cell of unit
+	              u is byte u/2, low nibble first, or byte u
+	A hand comes after those with a latest before its earliest, and
+	its own earlier hands, as in the .no.
+*/
+#define TXBALIGN 64
+
+static void
+	putU32(FILE *fp, uint32_t n)
+{
+	int ii;
+
+	for (ii = 0; ii < 4; ii++)
+		putc((int) (n >> (8 * ii)) & 0xFF, fp);
+}
+
+static void
+	putU64(FILE *fp, uint64_t n)
+{
+	putU32(fp, (uint32_t) n);
+	putU32(fp, (uint32_t) (n >> 32));
+}
+
+// Pad fp out to the next line, from *at bytes; returns where that is.
+static uint64_t
+	padTxb(FILE *fp, uint64_t *at)
+{
+	while (*at % TXBALIGN) {
+		putc(0, fp);
+		(*at)++;
+	}
+	return *at;
+}
+
+static void
+	writeTxb(Context *ctx)
+{
+	Matrix *mat = &ctx->mat;
+	int *unit, *wgt, *rowOf, nUnits = 0, nHands = 0;
+	int pp, ms, hh, var, ii, uu, bits;
+	unsigned char code[256], table[16];
+	size_t rowBytes, namesLen = 0;
+	uint64_t at, offWgt, offHand, offName, offMat;
+	unsigned char *row;
+	int nCodes = 0, seen[256];
+	FILE *fp = ctx->fpTxb;
+
+	// The units, or else patterns, in .tx order, and the hands' rows
+	unit = new(mat->nCols + 1, int);
+	wgt = new(mat->nCols + 1, int);
+	rowOf = new(activeMSS(ctx) + 1, int);
+	assert( unit && wgt && rowOf );
+	for (var = 0; var < mat->nCols; var++) {
+		if (ctx->wgts[var] <= 0)
+			continue;
+		if (!ctx->txCol) {
+			unit[nUnits] = var;
+			wgt[nUnits++] = ctx->wgts[var];
+		} else if (ctx->txCol[var] == nUnits) {
+			unit[nUnits] = var;
+			wgt[nUnits++] = ctx->wgts[var];
+		} else
+			wgt[ctx->txCol[var]] += ctx->wgts[var];
+	}
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Hand *hands = ctx->par[pp].msHands[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (!hands[hh].suppressed) {
+				rowOf[nHands++] = hands[hh].row;
+				namesLen += strlen(parName(ctx, pp, ctx->mss[ms].corrected, hh, ctx->mss[ms].pname)) + 1;
+			}
+		}
+	}
+
+	// Sixteen states or fewer go four bits a cell
+	for (ii = 0; ii < 256; ii++)
+		seen[ii] = NO;
+	for (ii = 0; ii < nHands; ii++) {
+		char *r = &mat->rows[rowOf[ii] * mat->nCols];
+		for (uu = 0; uu < nUnits; uu++)
+			seen[(unsigned char) r[unit[uu]]] = YES;
+	}
+	memset(table, 0, sizeof table);
+	for (ii = 0; ii < 256; ii++) {
+		if (seen[ii] && nCodes < 16)
+			table[nCodes] = ii;
+		code[ii] = (seen[ii]) ? nCodes++ : 0;
+	}
+	bits = (nCodes <= 16) ? 4 : 8;
+	if (bits == 8) {
+		memset(table, 0, sizeof table);
+		for (ii = 0; ii < 256; ii++)
+			code[ii] = ii;
+	}
+	rowBytes = (((size_t) nUnits * bits + 7) / 8 + TXBALIGN - 1) / TXBALIGN * TXBALIGN;
+
+	offWgt = 2 * TXBALIGN;
+	offHand = (offWgt + 4 * (uint64_t) nUnits + TXBALIGN - 1) / TXBALIGN * TXBALIGN;
+	offName = (offHand + 32 * (uint64_t) nHands + TXBALIGN - 1) / TXBALIGN * TXBALIGN;
+	offMat = (offName + namesLen + TXBALIGN - 1) / TXBALIGN * TXBALIGN;
+
+	fwrite("preptxb1", 1, 8, fp);
+	putU32(fp, nHands);
+	putU32(fp, nUnits);
+	putU32(fp, ctx->wvar);
+	putU32(fp, bits);
+	putU32(fp, rowBytes);
+	putU32(fp, 0);
+	putU64(fp, offWgt);
+	putU64(fp, offHand);
+	putU64(fp, offName);
+	putU64(fp, offMat);
+	fwrite(table, 1, sizeof table, fp);
+	at = 64 + sizeof table;
+	padTxb(fp, &at);		// (The rest of the header is spare)
+	assert( at == offWgt );
+
+	for (uu = 0; uu < nUnits; uu++)
+		putU32(fp, wgt[uu]);
+	at += 4 * (uint64_t) nUnits;
+	padTxb(fp, &at);
+
+	namesLen = 0;
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		Hand *hands = ctx->par[pp].msHands[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (hands[hh].suppressed)
+				continue;
+			putU32(fp, hands[hh].stratum);
+			putU32(fp, hands[hh].earliest);
+			putU32(fp, hands[hh].latest);
+			putU32(fp, pp);
+			putU32(fp, ms);
+			putU32(fp, hh);
+			putU32(fp, namesLen);
+			putU32(fp, 0);
+			namesLen += strlen(parName(ctx, pp, w->corrected, hh, w->pname)) + 1;
+		}
+	}
+	at += 32 * (uint64_t) nHands;
+	padTxb(fp, &at);
+
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		Hand *hands = ctx->par[pp].msHands[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (hands[hh].suppressed)
+				continue;
+			fputs(parName(ctx, pp, w->corrected, hh, w->pname), fp);
+			putc(EOS, fp);
+		}
+	}
+	at += namesLen;
+	padTxb(fp, &at);
+	assert( at == offMat );
+
+	row = new(rowBytes + 1, unsigned char);
+	assert( row );
+	for (ii = 0; ii < nHands; ii++) {
+		char *r = &mat->rows[rowOf[ii] * mat->nCols];
+
+		memset(row, 0, rowBytes);
+		for (uu = 0; uu < nUnits; uu++) {
+			int c = code[(unsigned char) r[unit[uu]]];
+			if (bits == 8)
+				row[uu] = c;
+			else
+				row[uu / 2] |= c << (4 * (uu & 1));
+		}
+		fwrite(row, 1, rowBytes, fp);
+	}
+	free(row);
+	free(rowOf);
+	free(wgt);
+	free(unit);
+}
+
+/*
+	DM:  base.dm has, for each pair of the hands of the .tx, the units
+	where they agree, the units where both are extant (not '?'), and
+	the weight of those where they differ.  After a line of the hands
+	and units, a line a pair, in the order of the .tx:
+
+	   a b agree comparable distance
+
+	The units go into words of 64 by weight, a weight a word, and each
+	hand's states into bitplanes:  a word of where it is extant, and a
+	word for each bit of the state's code.  Two hands agree where both
+	are extant and no plane differs.  The pairs are worked out a tile
+	of DMTILE hands by DMTILE at a time, DMSPAN words at a time, and
+	the tiles are shared out among the jobs (-j).
+*/
+#define DMTILE 32
+#define DMSPAN 256
+
+static void
+	dmShare(Share *s)
+{
+	Planes *pl = (Planes *) s->arg;
+	int stride = pl->nWords * (pl->nPlanes + 1), t, w0;
+
+	for (t = s->lo; t < s->hi; t++) {
+		int i0 = pl->tiles[2*t] * DMTILE, j0 = pl->tiles[2*t+1] * DMTILE;
+		int i1 = (i0 + DMTILE < pl->nHands) ? i0 + DMTILE : pl->nHands;
+		int j1 = (j0 + DMTILE < pl->nHands) ? j0 + DMTILE : pl->nHands;
+
+		for (w0 = 0; w0 < pl->nWords; w0 += DMSPAN) {
+			int w1 = (w0 + DMSPAN < pl->nWords) ? w0 + DMSPAN : pl->nWords;
+			int ii, jj, ww, bb;
+
+			for (ii = i0; ii < i1; ii++)
+			for (jj = (j0 > ii) ? j0 : ii+1; jj < j1; jj++) {
+				const uint64_t *a = &pl->bits[(size_t) ii * stride];
+				const uint64_t *b = &pl->bits[(size_t) jj * stride];
+				unsigned agree = 0, comp = 0, dist = 0;
+
+				for (ww = w0; ww < w1; ww++) {
+					const uint64_t *aw = &a[ww * (pl->nPlanes + 1)];
+					const uint64_t *bw = &b[ww * (pl->nPlanes + 1)];
+					uint64_t both = aw[0] & bw[0], differ = 0;
+					int nBoth, nSame;
+
+					for (bb = 1; bb <= pl->nPlanes; bb++)
+						differ |= aw[bb] ^ bw[bb];
+					nBoth = __builtin_popcountll(both);
+					nSame = __builtin_popcountll(both & ~differ);
+					comp += nBoth;
+					agree += nSame;
+					dist += (nBoth - nSame) * pl->wordWgt[ww];
+				}
+				pl->agree[(size_t) ii * pl->nHands + jj] += agree;
+				pl->comp[(size_t) ii * pl->nHands + jj] += comp;
+				pl->dist[(size_t) ii * pl->nHands + jj] += dist;
+			}
+		}
+	}
+}
+
+static void
+	writeDm(Context *ctx)
+{
+	Matrix *mat = &ctx->mat;
+	int *rowOf, *slot, *wgts, nWgts = 0, nUnits = 0, nTiles;
+	int pp, ms, hh, var, ii, jj, bb, nCodes = 0, code[256];
+	char **names;
+	Planes pl[1];
+	FILE *fp = ctx->fpDm;
+
+	memset(pl, 0, sizeof pl);
+	rowOf = new(activeMSS(ctx) + 1, int);
+	names = new(activeMSS(ctx) + 1, char *);
+	assert( rowOf && names );
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		Hand *hands = ctx->par[pp].msHands[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (hands[hh].suppressed)
+				continue;
+			rowOf[pl->nHands] = hands[hh].row;
+			names[pl->nHands] = strdup(parName(ctx, pp, w->corrected, hh, w->pname));
+			assert( names[pl->nHands] );
+			pl->nHands++;
+		}
+	}
+
+	// The weights, each starting a run of words; then each unit's slot
+	wgts = new(mat->nCols + 1, int);
+	slot = new(mat->nCols + 1, int);
+	assert( wgts && slot );
+	for (var = 0; var < mat->nCols; var++) {
+		if (ctx->wgts[var] <= 0)
+			continue;
+		for (ii = 0; ii < nWgts && wgts[ii] != ctx->wgts[var]; ii++)
+			;
+		if (ii == nWgts)
+			wgts[nWgts++] = ctx->wgts[var];
+		nUnits++;
+	}
+	{
+		int *at = new(nWgts + 1, int), next = 0;
+
+		assert( at );
+		for (ii = 0; ii < nWgts; ii++)
+			at[ii] = 0;
+		for (var = 0; var < mat->nCols; var++) {
+			for (ii = 0; ctx->wgts[var] > 0 && wgts[ii] != ctx->wgts[var]; ii++)
+				;
+			if (ctx->wgts[var] > 0)
+				at[ii]++;
+		}
+		for (ii = 0; ii < nWgts; ii++) {
+			int n = at[ii];
+			at[ii] = next;
+			next += (n + 63) / 64 * 64;
+		}
+		pl->nWords = next / 64;
+		pl->wordWgt = new(pl->nWords + 1, int);
+		assert( pl->wordWgt );
+		for (var = 0; var < mat->nCols; var++) {
+			slot[var] = -1;
+			if (ctx->wgts[var] <= 0)
+				continue;
+			for (ii = 0; wgts[ii] != ctx->wgts[var]; ii++)
+				;
+			slot[var] = at[ii]++;
+			pl->wordWgt[slot[var] / 64] = ctx->wgts[var];
+		}
+		free(at);
+	}
+
+	// A code for each state, and the bits it takes
+	for (ii = 0; ii < 256; ii++)
+		code[ii] = -1;
+	for (ii = 0; ii < pl->nHands; ii++) {
+		char *r = &mat->rows[rowOf[ii] * mat->nCols];
+		for (var = 0; var < mat->nCols; var++) {
+			int c = (unsigned char) r[var];
+			if (slot[var] >= 0 && c != MISSING && code[c] < 0)
+				code[c] = nCodes++;
+		}
+	}
+	for (pl->nPlanes = 1; (1 << pl->nPlanes) < nCodes; pl->nPlanes++)
+		;
+
+	pl->bits = calloc((size_t) pl->nHands * pl->nWords * (pl->nPlanes + 1) + 1, sizeof (uint64_t));
+	assert( pl->bits );
+	for (ii = 0; ii < pl->nHands; ii++) {
+		uint64_t *h = &pl->bits[(size_t) ii * pl->nWords * (pl->nPlanes + 1)];
+		char *r = &mat->rows[rowOf[ii] * mat->nCols];
+
+		for (var = 0; var < mat->nCols; var++) {
+			uint64_t bit = (uint64_t) 1 << (slot[var] & 63);
+			uint64_t *w = &h[(slot[var] / 64) * (pl->nPlanes + 1)];
+			int c = (unsigned char) r[var];
+
+			if (slot[var] < 0 || c == MISSING)
+				continue;
+			w[0] |= bit;
+			for (bb = 0; bb < pl->nPlanes; bb++) {
+				if (code[c] >> bb & 1)
+					w[1 + bb] |= bit;
+			}
+		}
+	}
+
+	// The pairs of tiles, about the same work each but on the diagonal
+	nTiles = (pl->nHands + DMTILE - 1) / DMTILE;
+	pl->tiles = new(nTiles * (nTiles + 1) + 1, int);
+	assert( pl->tiles );
+	for (ii = 0; ii < nTiles; ii++)
+	for (jj = ii; jj < nTiles; jj++) {
+		pl->tiles[2 * pl->nTiles] = ii;
+		pl->tiles[2 * pl->nTiles + 1] = jj;
+		pl->nTiles++;
+	}
+	pl->agree = calloc((size_t) pl->nHands * pl->nHands + 1, sizeof (unsigned));
+	pl->comp = calloc((size_t) pl->nHands * pl->nHands + 1, sizeof (unsigned));
+	pl->dist = calloc((size_t) pl->nHands * pl->nHands + 1, sizeof (unsigned));
+	assert( pl->agree && pl->comp && pl->dist );
+	shareOut(ctx, 0, pl->nTiles, dmShare, pl);
+
+	fprintf(fp, "%-9d %d\n", pl->nHands, nUnits);
+	for (ii = 0; ii < pl->nHands; ii++)
+	for (jj = ii+1; jj < pl->nHands; jj++) {
+		size_t at = (size_t) ii * pl->nHands + jj;
+		fprintf(fp, "%-9s %-9s %6u %6u %6u\n", names[ii], names[jj],
+			pl->agree[at], pl->comp[at], pl->dist[at]);
+	}
+
+	for (ii = 0; ii < pl->nHands; ii++)
+		free(names[ii]);
+	free(names);
+	free(rowOf);
+	free(wgts);
+	free(slot);
+	free(pl->wordWgt);
+	free(pl->bits);
+	free(pl->tiles);
+	free(pl->agree);
+	free(pl->comp);
+	free(pl->dist);
+}
+
+/* ------------------------------------------------------
+||
+||  Run statistics (--stats):  the time and peak memory of each phase,
+||  what the parse counted, and the size of each output, as JSON in
+||  base.stats.json.  Phases that run more than once (suppressVr, and
+||  the lot under --sweep) get an entry each time.
+||
+*/
+
+static double
+	seconds(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Start timing a phase:  wall and CPU seconds.
+static void
+	startPhase(double t[2])
+{
+	t[0] = seconds(CLOCK_MONOTONIC);
+	t[1] = seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+// End the phase timed in t, noting it if --stats; t then starts the next.
+static void
+	endPhase(Context *ctx, const char *name, double t[2])
+{
+	Stats *st = ctx->stats;
+	struct rusage ru;
+	double t0 = t[0], t1 = t[1];
+	Phase *ph;
+
+	startPhase(t);
+	if (!st)
+		return;
+	st->phases = growArray(st->phases, &st->maxPhases, st->nPhases+1, sizeof (Phase));
+	ph = &st->phases[st->nPhases++];
+	ph->name = name;
+	ph->wall = t[0] - t0;
+	ph->cpu = t[1] - t1;
+	getrusage(RUSAGE_SELF, &ru);
+	ph->maxRss = ru.ru_maxrss;
+}
+
+// Add up what the output files took, before they are closed.
+static void
+	noteBytes(Context *ctx)
+{
+	FILE *fps[] = { ctx->fpTx, ctx->fpNo, ctx->fpVr, ctx->fpTxb, ctx->fpDm };
+	int ii;
+
+	if (!ctx->stats)
+		return;
+	for (ii = 0; ii < dimof(fps); ii++) {
+		long n = (fps[ii]) ? ftell(fps[ii]) : -1;
+		if (n > 0)
+			ctx->stats->bytes[ii] += n;
+	}
+}
+
+static void
+	addCounts(Counts *to, const Counts *from)
+{
+	to->tokens += from->tokens;
+	to->findMSS += from->findMSS;
+	to->macros += from->macros;
+	to->interns += from->interns;
+}
+
+static void
+	jsonStr(FILE *fp, const char *s)
+{
+	putc('"', fp);
+	for ( ; *s; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(fp, "\\%c", *s);
+		else if ((unsigned char) *s < ' ')
+			fprintf(fp, "\\u%04x", (unsigned char) *s);
+		else
+			putc(*s, fp);
+	}
+	putc('"', fp);
+}
+
+static void
+	writeStats(Context *ctx)
+{
+	static char *ext[] = { "tx", "no", "vr", "txb", "dm" };
+	Stats *st = ctx->stats;
+	FILE *fp;
+	int ii;
+
+	if (!st || !(fp = outFile(ctx->base, "stats.json")))
+		return;
+	fprintf(fp, "{\n  \"collation\": ");
+	jsonStr(fp, ctx->base);
+	fprintf(fp, ",\n  \"jobs\": %d,\n  \"phases\": [", (ctx->nJobs > 1) ? ctx->nJobs : 1);
+	for (ii = 0; ii < st->nPhases; ii++) {
+		Phase *ph = &st->phases[ii];
+		fprintf(fp, "%s\n    { \"name\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f, \"maxRssKB\": %ld }",
+			(ii) ? "," : "", ph->name, ph->wall, ph->cpu, ph->maxRss);
+	}
+	fprintf(fp, "\n  ],\n  \"counters\": {\n");
+	fprintf(fp, "    \"tokens\": %lu,\n", ctx->counts.tokens);
+	fprintf(fp, "    \"findMSS\": %lu,\n", ctx->counts.findMSS);
+	fprintf(fp, "    \"macros\": %lu,\n", ctx->counts.macros);
+	fprintf(fp, "    \"statesInterned\": %d,\n", ctx->nInterned);
+	fprintf(fp, "    \"statesDuplicate\": %lu,\n", ctx->counts.interns - ctx->nInterned);
+	fprintf(fp, "    \"parallels\": %d, \"mss\": %d, \"varUnits\": %d, \"pieces\": %d, \"sets\": %d\n",
+		ctx->nParallels, ctx->nMSS, ctx->nVar, ctx->nPiece, ctx->nSets);
+	fprintf(fp, "  },\n  \"bytes\": {");
+	for (ii = 0; ii < dimof(ext); ii++)
+		fprintf(fp, "%s \"%s\": %ld", (ii) ? "," : "", ext[ii], st->bytes[ii]);
+	fprintf(fp, " }\n}\n");
+	fclose(fp);
+}
+
+/* ------------------------------------------------------
+||
+||  Jobs after the parse (-j N):  a phase cuts its units, witnesses or
+||  lines into a run a job, one on this thread and the rest on threads
+||  of their own, and puts what they found together in order, so that
+||  what it writes is as a single job would write it.
+||
+*/
+
+// Jobs to share n items between
+static int
+	nShares(Context *ctx, int n)
+{
+	int nJobs = (ctx->nJobs < n) ? ctx->nJobs : n;
+
+	return (nJobs > 1) ? nJobs : 1;
+}
+
+static void *
+	runShare(void *arg)
+{
+	Share *s = (Share *) arg;
+
+	s->fn(s);
+	return arg;
+}
+
+// Run fn over [lo, hi), a run of it a job, and wait for them all.
+static void
+	shareOut(Context *ctx, int lo, int hi, void (*fn)(Share *), void *arg)
+{
+	int nJobs = nShares(ctx, hi - lo), jj;
+	Share *shares = new(nJobs, Share);
+	pthread_t *tids = new(nJobs, pthread_t);
+	int *started = new(nJobs, int);
+
+	assert( shares && tids && started );
+	for (jj = 0; jj < nJobs; jj++) {
+		Share *s = &shares[jj];
+
+		s->ctx = ctx;
+		s->job = jj;
+		s->lo = lo + (int) ((long) (hi - lo) * jj / nJobs);
+		s->hi = lo + (int) ((long) (hi - lo) * (jj+1) / nJobs);
+		s->arg = arg;
+		s->fn = fn;
+		started[jj] = jj > 0
+			&& pthread_create(&tids[jj], (pthread_attr_t *) 0, runShare, s) == 0;
+	}
+	runShare(&shares[0]);
+	for (jj = 1; jj < nJobs; jj++) {
+		if (started[jj])
+			pthread_join(tids[jj], (void **) 0);
+		else
+			runShare(&shares[jj]);
+	}
+	free(shares);
+	free(tids);
+	free(started);
+}
+
+/* ------------------------------------------------------
+||
+||  Suppression and output, once or for each setting of a sweep
+||
+*/
+
+// The suppression passes, which leave the matrix of the hands still active
+static void
+	suppress(Context *ctx, double t[2])
+{
+	buildMatrix(ctx);
+	endPhase(ctx, "buildMatrix", t);
+	suppressVr(ctx);
+	endPhase(ctx, "suppressVr", t);
+	suppressTx(ctx);
+	endPhase(ctx, "suppressTx", t);
+	buildMatrix(ctx);
+	endPhase(ctx, "buildMatrix", t);
+	suppressVr(ctx);
+	endPhase(ctx, "suppressVr", t);
+	if (!setting(ctx, "IDOK")) {
+		suppressId(ctx);
+		endPhase(ctx, "suppressId", t);
+	}
+}
+
+static void
+	process(Context *ctx)
+{
+	double t[2];
+
+	startPhase(t);
+	suppress(ctx, t);
+	writeTx(ctx);
+	endPhase(ctx, "writeTx", t);
+	writeNo(ctx);
+	endPhase(ctx, "writeNo", t);
+	writeVr(ctx);
+	endPhase(ctx, "writeVr", t);
+	if (ctx->fpTxb) {
+		writeTxb(ctx);
+		endPhase(ctx, "writeTxb", t);
+	}
+	if (ctx->fpDm) {
+		writeDm(ctx);
+		endPhase(ctx, "writeDm", t);
+	}
+}
+
+// Parse a --sweep NAME=v1,v2,... argument.
+static int
+	addSweep(Context *ctx, char *arg)
+{
+	static char *names[] = { "FRAG", "CORR", "YEAR", "NOSING", };
+	SweepVar *sv;
+	char *s;
+	int ii;
+
+	arg = strdup(arg);
+	assert( arg );
+	s = strchr(arg, '=');
+	*s++ = EOS;
+	for (ii = 0; ii < dimof(names); ii++) {
+		if (strcmp(arg, names[ii]) == 0)
+			break;
+	}
+	if (ii == dimof(names)) {
+		fprintf(stderr, "Cannot sweep %s (only FRAG, CORR, YEAR or NOSING)\n", arg);
+		return NO;
+	}
+
+	ctx->sweep = realloc(ctx->sweep, (ctx->nSweep+1) * sizeof (SweepVar));
+	assert( ctx->sweep );
+	sv = &ctx->sweep[ctx->nSweep++];
+	sv->name = arg;
+	sv->values = new(strlen(s)/2 + 2, char *);
+	assert( sv->values );
+	sv->nValues = 0;
+	for (;;) {
+		sv->values[sv->nValues++] = s;
+		if (!(s = strchr(s, ',')))
+			break;
+		*s++ = EOS;
+	}
+	return YES;
+}
+
+static void
+	saveState(Context *ctx, Snapshot *snap)
+{
+	int pp, ms;
+	Hand *h;
+
+	snap->wvar = ctx->wvar;
+	snap->wgts = new(ctx->nVar + 1, int);
+	snap->corrected = new(ctx->nMSS, int);
+	snap->hands = new(ctx->nParallels * ctx->nMSS * MAXHAND, Hand);
+	assert( snap->wgts && snap->corrected && snap->hands );
+
+	memcpy(snap->wgts, ctx->wgts, ctx->nVar * sizeof (int));
+	for (ms = 0; ms < ctx->nMSS; ms++)
+		snap->corrected[ms] = ctx->mss[ms].corrected;
+	h = snap->hands;
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++, h += MAXHAND)
+		memcpy(h, ctx->par[pp].msHands[ms], MAXHAND * sizeof (Hand));
+}
+
+static void
+	restoreState(Context *ctx, Snapshot *snap)
+{
+	int pp, ms;
+	Hand *h;
+
+	ctx->wvar = snap->wvar;
+	memcpy(ctx->wgts, snap->wgts, ctx->nVar * sizeof (int));
+	for (ms = 0; ms < ctx->nMSS; ms++)
+		ctx->mss[ms].corrected = snap->corrected[ms];
+	h = snap->hands;
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++, h += MAXHAND)
+		memcpy(ctx->par[pp].msHands[ms], h, MAXHAND * sizeof (Hand));
+}
+
+// Run the passes and write base.tag.{tx,no,vr}, or base.{tx,no,vr} with no tag.
+static void
+	outputs(Context *ctx, char *tag)
+{
+	char ext[MAXTOKEN+4];
+
+	snprintf(ext, dimof(ext), "%s%stx", (tag) ? tag : "", (tag) ? "." : "");
+	ctx->fpTx = outFile(ctx->base, ext);
+	snprintf(ext, dimof(ext), "%s%sno", (tag) ? tag : "", (tag) ? "." : "");
+	ctx->fpNo = outFile(ctx->base, ext);
+	snprintf(ext, dimof(ext), "%s%svr", (tag) ? tag : "", (tag) ? "." : "");
+	ctx->fpVr = outFile(ctx->base, ext);
+	snprintf(ext, dimof(ext), "%s%stxb", (tag) ? tag : "", (tag) ? "." : "");
+	ctx->fpTxb = (setting(ctx, "TXB")) ? outFile(ctx->base, ext) : (FILE *) 0;
+	snprintf(ext, dimof(ext), "%s%sdm", (tag) ? tag : "", (tag) ? "." : "");
+	ctx->fpDm = (setting(ctx, "DM")) ? outFile(ctx->base, ext) : (FILE *) 0;
+	if (ctx->fpTx && ctx->fpNo && ctx->fpVr)
+		process(ctx);
+	noteBytes(ctx);
+	if (ctx->fpTxb)
+		fclose(ctx->fpTxb);
+	if (ctx->fpDm)
+		fclose(ctx->fpDm);
+	if (ctx->fpTx)
+		fclose(ctx->fpTx);
+	if (ctx->fpNo)
+		fclose(ctx->fpNo);
+	if (ctx->fpVr)
+		fclose(ctx->fpVr);
+}
+
+// A setting for the passes:  the value being swept, else the library's
+// settings, else the environment's.
+static char *
+	setting(Context *ctx, char *name)
+{
+	int ii;
+
+	if (ctx->sweepAt) {
+		for (ii = 0; ii < ctx->nSweep; ii++) {
+			SweepVar *sv = &ctx->sweep[ii];
+			if (strcmp(sv->name, name) == 0)
+				return (*sv->values[ctx->sweepAt[ii]]) ? sv->values[ctx->sweepAt[ii]] : (char *) 0;
+		}
+	}
+	if (ctx->settings) {
+		const PrepSettings *s = ctx->settings;
+
+		if (strcmp(name, "FRAG") == 0)
+			return s->frag;
+		if (strcmp(name, "CORR") == 0)
+			return s->corr;
+		if (strcmp(name, "YEAR") == 0)
+			return s->year;
+		if (strcmp(name, "NOSING") == 0)
+			return (s->noSing) ? "1" : (char *) 0;
+		if (strcmp(name, "IDOK") == 0)
+			return (s->idOk) ? "1" : (char *) 0;
+		return (char *) 0;
+	}
+	return getenv(name);
+}
+
+/*
+	Run the suppression passes and write base.<tag>.{tx,no,vr} for every
+	combination of the swept settings, all from the one parse.  The tag
+	is the combination, e.g. FRAG=30%_CORR=5%.
+*/
+static void
+	sweep(Context *ctx)
+{
+	Snapshot snap[1];
+	int ii;
+
+	ctx->sweepAt = new(ctx->nSweep, int);
+	assert( ctx->sweepAt );
+	for (ii = 0; ii < ctx->nSweep; ii++)
+		ctx->sweepAt[ii] = 0;
+	saveState(ctx, snap);
+
+	for (;;) {
+		char tag[MAXTOKEN];
+		char *t = tag;
+
+		for (ii = 0; ii < ctx->nSweep; ii++) {
+			SweepVar *sv = &ctx->sweep[ii];
+
+			t += snprintf(t, &tag[dimof(tag)] - t, "%s%s=%s",
+				(ii) ? "_" : "", sv->name, sv->values[ctx->sweepAt[ii]]);
+			if (t >= &tag[dimof(tag)])
+				t = &tag[dimof(tag)-1];
+		}
+		fprintf(ctx->fpOut, "Sweep: %s\n", tag);
+		fprintf(ctx->fpErr, "Sweep: %s\n", tag);
+
+		restoreState(ctx, snap);
+		outputs(ctx, tag);
+
+		// Next combination, the last variable fastest
+		for (ii = ctx->nSweep-1; ii >= 0; ii--) {
+			if (++ctx->sweepAt[ii] < ctx->sweep[ii].nValues)
+				break;
+			ctx->sweepAt[ii] = 0;
+		}
+		if (ii < 0)
+			break;
+	}
+
+	free(ctx->sweepAt);
+	ctx->sweepAt = (int *) 0;
+	free(snap->wgts);
+	free(snap->corrected);
+	free(snap->hands);
+}
+
+/*
+	Subset groups:  each +TAG: on the command-line gets its own copy of
+	the state the passes change (hands, weights and witnesses) over the
+	shared parse, and its own base.TAG.{tx,no,vr}.  Groups are run on
+	threads of their own; what they print is held back and then copied
+	out in command-line order.
+*/
+static Context *
+	cloneContext(Context *ctx, Group *g)
+{
+	Context *c = new(1, Context);
+	int pp, ms;
+
+	assert( c );
+	*c = *ctx;
+	c->subset = g->subset;
+	c->base = new(strlen(ctx->base) + strlen(g->tag) + 2, char);
+	assert( c->base );
+	sprintf(c->base, "%s.%s", ctx->base, g->tag);
+
+	c->wgts = new(ctx->nVar + 1, int);
+	c->mss = new(ctx->nMSS, Witness);
+	assert( c->wgts && c->mss );
+	memcpy(c->wgts, ctx->wgts, ctx->nVar * sizeof (int));
+	memcpy(c->mss, ctx->mss, ctx->nMSS * sizeof (Witness));
+	memset(&c->arena, 0, sizeof c->arena);
+	c->interned = (char **) 0;
+	c->internMask = 0;
+	c->nInterned = 0;
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		Hand *block = arenaAlloc(&c->arena, ctx->nMSS * MAXHAND * sizeof (Hand));
+
+		c->par[pp].msHands = arenaAlloc(&c->arena, ctx->nMSS * sizeof (Hand *));
+		for (ms = 0; ms < ctx->nMSS; ms++) {
+			c->par[pp].msHands[ms] = &block[ms * MAXHAND];
+			memcpy(c->par[pp].msHands[ms], ctx->par[pp].msHands[ms], MAXHAND * sizeof (Hand));
+		}
+	}
+	memset(&c->mat, 0, sizeof c->mat);
+	c->txCol = (int *) 0;
+	c->stats = (Stats *) 0;
+
+	c->fpOut = open_memstream(&g->out, &g->outLen);
+	c->fpErr = open_memstream(&g->err, &g->errLen);
+	assert( c->fpOut && c->fpErr );
+	return c;
+}
+
+static void
+	freeContext(Context *c)
+{
+	freeArena(&c->arena);
+	free(c->mat.rows);
+	free(c->mat.cols);
+	free(c->txCol);
+	free(c->wgts);
+	free(c->mss);
+	free(c->base);
+	free(c);
+}
+
+static void *
+	runGroup(void *arg)
+{
+	Context *ctx = (Context *) arg;
+
+	mandateTx(ctx);
+	if (ctx->nSweep)
+		sweep(ctx);
+	else
+		outputs(ctx, (char *) 0);
+	fclose(ctx->fpOut);
+	fclose(ctx->fpErr);
+	return arg;
+}
+
+static void
+	runGroups(Context *ctx)
+{
+	pthread_t *tids = new(ctx->nGroups, pthread_t);
+	Context **ctxs = new(ctx->nGroups, Context *);
+	int *started = new(ctx->nGroups, int);
+	int gg;
+
+	assert( tids && ctxs && started );
+	for (gg = 0; gg < ctx->nGroups; gg++) {
+		ctxs[gg] = cloneContext(ctx, &ctx->groups[gg]);
+		started[gg] = pthread_create(&tids[gg], (pthread_attr_t *) 0, runGroup, ctxs[gg]) == 0;
+		if (!started[gg])
+			runGroup(ctxs[gg]);
+	}
+
+	for (gg = 0; gg < ctx->nGroups; gg++) {
+		Group *g = &ctx->groups[gg];
+
+		if (started[gg])
+			pthread_join(tids[gg], (void **) 0);
+		printf("Group %s:\n", g->tag);
+		fwrite(g->out, 1, g->outLen, stdout);
+		fprintf(stderr, "Group %s:\n", g->tag);
+		fwrite(g->err, 1, g->errLen, stderr);
+		free(g->out);
+		free(g->err);
+		freeContext(ctxs[gg]);
+	}
+	fflush(stdout);
+
+	free(tids);
+	free(ctxs);
+	free(started);
+}
+
+// Parse a +TAG: group marker, the start of a subset group.
+static int
+	addGroup(Context *ctx, char *arg)
+{
+	Group *g;
+	int len = strlen(arg);
+
+	if (len < 3 || arg[0] != '+' || arg[len-1] != ':')
+		return NO;
+	ctx->groups = realloc(ctx->groups, (ctx->nGroups+1) * sizeof (Group));
+	assert( ctx->groups );
+	g = &ctx->groups[ctx->nGroups++];
+	g->tag = strdup(&arg[1]);
+	assert( g->tag );
+	g->tag[len-2] = EOS;
+	g->subset = new(1, char *);
+	assert( g->subset );
+	g->subset[0] = (char *) 0;
+	g->nSubset = 0;
+	return YES;
+}
+
+// Add the witnesses (separated by blanks) in arg to the last group.
+static void
+	addToGroup(Context *ctx, char *arg)
+{
+	Group *g = &ctx->groups[ctx->nGroups-1];
+	char *w;
+
+	arg = strdup(arg);
+	assert( arg );
+	for (w = strtok(arg, " \t\n"); w; w = strtok((char *) 0, " \t\n")) {
+		g->subset = realloc(g->subset, (g->nSubset+2) * sizeof (char *));
+		assert( g->subset );
+		g->subset[g->nSubset++] = w;
+		g->subset[g->nSubset] = (char *) 0;
+	}
+}
+
+/* ------------------------------------------------------
+||
+||  Parse cache:  base.prepc holds everything the passes need from a
+||  clean parse, keyed on the collation and Chron files (size, mtime and
+||  a content hash) and on ROOT, WEIGHBYED and AUTOED.  Numbers are
+||  varints, and a hand's sets are stored as the index within their
+||  piece's sets.
+||
+*/
+
+#define CACHEMAGIC "prepc 4\n"
+
+// Content hash, a word at a time
+static uint64_t
+	hashBytes(const char *p, size_t n)
+{
+	uint64_t hash = 0x9E3779B97F4A7C15ull ^ n, w;
+
+	for ( ; n >= 8; p += 8, n -= 8) {
+		memcpy(&w, p, 8);
+		hash = (hash ^ w) * 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 32;
+	}
+	for ( ; n > 0; p++, n--)
+		hash = (hash ^ (unsigned char) *p) * 0x100000001B3ull;
+	return hash ^ (hash >> 29);
+}
+
+// Size, mtime and hash of a file (or NO if it cannot be read)
+static int
+	fileKey(char *fn, uint64_t key[3])
+{
+	struct stat st;
+	FILE *fp = fopen(fn, "r");
+	char *buf;
+
+	if (!fp)
+		return NO;
+	if (fstat(fileno(fp), &st) < 0 || !(buf = new(st.st_size + 1, char))) {
+		fclose(fp);
+		return NO;
+	}
+	key[0] = st.st_size;
+	key[1] = st.st_mtime;
+	key[2] = hashBytes(buf, fread(buf, 1, st.st_size, fp));
+	free(buf);
+	fclose(fp);
+	return YES;
+}
+
+static void
+	putNum(FILE *fp, uint64_t n)
+{
+	while (n >= 0x80) {
+		putc_unlocked((int) (n & 0x7F) | 0x80, fp);
+		n >>= 7;
+	}
+	putc_unlocked((int) n, fp);
+}
+
+// Signed numbers are zig-zagged, so that small negatives stay short.
+static void
+	putInt(FILE *fp, long n)
+{
+	putNum(fp, (n < 0) ? ~((uint64_t) n << 1) : (uint64_t) n << 1);
+}
+
+static void
+	putStr(FILE *fp, char *s)
+{
+	size_t len = (s) ? strlen(s) : 0;
+
+	putNum(fp, (s) ? len + 1 : 0);
+	if (s)
+		fwrite(s, 1, len, fp);
+}
+
+static uint64_t
+	getNum(CacheIn *in)
+{
+	uint64_t n = 0;
+	int shift = 0;
+
+	if (in->p < in->end && *in->p < 0x80)
+		return *in->p++;		// (Most are a byte)
+	while (in->p < in->end && shift < 64) {
+		int c = *in->p++;
+		n |= (uint64_t) (c & 0x7F) << shift;
+		if (!(c & 0x80))
+			return n;
+		shift += 7;
+	}
+	in->bad = YES;
+	return 0;
+}
+
+static long
+	getInt(CacheIn *in)
+{
+	uint64_t n = getNum(in);
+
+	return (n & 1) ? (long) ~(n >> 1) : (long) (n >> 1);
+}
+
+// A bounded count, to keep a damaged cache from asking for the moon
+static int
+	getCount(CacheIn *in, long max)
+{
+	long n = getInt(in);
+
+	if (n < 0 || n > max) {
+		in->bad = YES;
+		return 0;
+	}
+	return (int) n;
+}
+
+static char *
+	getStr(CacheIn *in)
+{
+	uint64_t len = getNum(in);
+	char *s;
+
+	if (len == 0 || in->bad)
+		return (char *) 0;
+	if (--len > (uint64_t) (in->end - in->p)) {
+		in->bad = YES;
+		return (char *) 0;
+	}
+	s = new(len + 1, char);
+	assert( s );
+	memcpy(s, in->p, len);
+	s[len] = EOS;
+	in->p += len;
+	return s;
+}
+
+// A string, as getStr(), but kept in the arena of ctx
+static char *
+	getArenaStr(Context *ctx, CacheIn *in)
+{
+	char *s = getStr(in), *t;
+
+	if (!s)
+		return (char *) 0;
+	t = arenaStr(&ctx->arena, s);
+	free(s);
+	return t;
+}
+
+// A string, as getStr(), but interned in ctx
+static char *
+	getInterned(Context *ctx, CacheIn *in)
+{
+	uint64_t len = getNum(in);
+	char *s;
+
+	if (len == 0 || in->bad)
+		return (char *) 0;
+	if (--len > (uint64_t) (in->end - in->p)) {
+		in->bad = YES;
+		return (char *) 0;
+	}
+	s = intern(ctx, (const char *) in->p, len);
+	in->p += len;
+	return s;
+}
+
+// Keeping the parse, with CACHE set or under --watch (never for stdin)
+static int
+	caching(Context *ctx)
+{
+	return (getenv("CACHE") || ctx->watching) && ctx->fpMss != stdin && !ctx->rangeFrom;
+}
+
+static char *
+	cacheName(Context *ctx)
+{
+	static char fn[MAXTOKEN*2];
+
+	snprintf(fn, dimof(fn), "%s.prepc", ctx->base);
+	return fn;
+}
+
+// Key of the collation itself, from the copy already in memory
+static void
+	mssKey(Context *ctx, uint64_t key[3])
+{
+	struct stat st;
+
+	if (fstat(fileno(ctx->fpMss), &st) < 0)
+		st.st_mtime = 0;
+	key[0] = ctx->mssLen;
+	key[1] = st.st_mtime;
+	key[2] = hashBytes(ctx->mssBuf, ctx->mssLen);
+}
+
+static void
+	writeCache(Context *ctx)
+{
+	char tmp[MAXTOKEN*2+1];
+	uint64_t key[3];
+	FILE *fp;
+	char *r;
+	int ii, pp, ms, hh, pc;
+
+	if (!caching(ctx))
+		return;
+	snprintf(tmp, dimof(tmp), "%s~", cacheName(ctx));
+	if (!(fp = fopen(tmp, "wb")))
+		return;
+
+	fputs(CACHEMAGIC, fp);
+	mssKey(ctx, key);
+	for (ii = 0; ii < 3; ii++)
+		putNum(fp, key[ii]);
+	putStr(fp, getenv("ROOT"));
+	putInt(fp, ctx->weighByED);
+	putInt(fp, ctx->autoED);
+	putInt(fp, ctx->nChron);
+	for (ii = 0; ii < ctx->nChron; ii++) {
+		uint64_t ck[3] = { 0, 0, 0 };
+		fileKey(ctx->chronFiles[ii], ck);
+		putStr(fp, ctx->chronFiles[ii]);
+		for (pc = 0; pc < 3; pc++)
+			putNum(fp, ck[pc]);
+	}
+
+	// Where the parse ended, for warnings from mandateTx()
+	putStr(fp, ctx->Root);
+	putInt(fp, ctx->lineno);
+	putInt(fp, ctx->token_lineno);
+	putStr(fp, ctx->lemma);
+	putInt(fp, ctx->didChron);
+	putInt(fp, ctx->wvar);
+
+	putInt(fp, ctx->nMSS);
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		putStr(fp, w->name);
+		putStr(fp, w->Aland);
+		putStr(fp, w->pname);
+		putInt(fp, w->corrected);
+	}
+
+	putInt(fp, ctx->nVar);
+	for (ii = 0; ii < ctx->nVar; ii++) {
+		putInt(fp, ctx->nRdgs[ii]);
+		putInt(fp, ctx->wgts[ii]);
+	}
+	putInt(fp, ctx->nVr);
+	for (ii = 0; ii < ctx->nVr; ii++)
+		putNum(fp, ctx->vrAt[ii]);
+	putInt(fp, ctx->nSets);
+	for (ii = 0; ii < ctx->nSets; ii++)
+		putStr(fp, ctx->states[ii]);
+	putInt(fp, ctx->nPiece);
+	for (pc = 0; pc < ctx->nPiece; pc++) {
+		putInt(fp, ctx->pieceUnits[pc]);
+		putInt(fp, ctx->pieceVar[pc]);
+		putInt(fp, ctx->pieceSet[pc]);
+	}
+
+	putInt(fp, ctx->nParallels);
+	putInt(fp, ctx->parallel);
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		Parallel *para = &ctx->par[pp];
+
+		putInt(fp, para->name_space);
+		putStr(fp, para->position);
+		for (ii = 0; ii < MAXMACRO; ii++) {
+			Macro *m = para->pMacros[ii];
+			int ww;
+
+			putInt(fp, m != 0);
+			if (!m)
+				continue;
+			putInt(fp, m->level);
+			for (ww = 0; ww < ctx->macWords; ww++)
+				putNum(fp, m->inset[ww]);
+		}
+
+		for (ms = 0; ms < ctx->nMSS; ms++)
+		for (hh = 0; hh < MAXHAND; hh++) {
+			Hand *h = &para->msHands[ms][hh];
+
+			putInt(fp, h->earliest);
+			putInt(fp, h->average);
+			putInt(fp, h->latest);
+			putInt(fp, h->suppressed);
+			putInt(fp, h->mandated);
+			putInt(fp, h->inLacuna);
+			putInt(fp, h->lastHand);
+			putInt(fp, h->nExtant);
+
+			// Each set as 1 + its index among the piece's sets, 0 for none
+			putInt(fp, (hh == 0) ? ctx->nPiece : h->nPcs);
+			for (ii = 0; ii < ((hh == 0) ? ctx->nPiece : h->nPcs); ii++) {
+				int set;
+
+				pc = (hh == 0) ? ii : h->pcs[ii];
+				r = (hh == 0) ? h->sets[pc] : h->pcSets[ii];
+				if (hh > 0)
+					putInt(fp, pc);
+				if (!r) {
+					putInt(fp, 0);
+					continue;
+				}
+				for (set = ctx->pieceSet[pc]; set < ctx->nSets; set++) {
+					if (ctx->states[set] == r)
+						break;
+				}
+				assert( set < ctx->nSets );
+				putInt(fp, set - ctx->pieceSet[pc] + 1);
+			}
+		}
+	}
+
+	putInt(fp, ctx->nPools);
+	for (ii = 0; ii < ctx->nPools; ii++) {
+		Pool *pool = &ctx->pools[ii];
+
+		putInt(fp, pool->parallel);
+		putInt(fp, pool->ms);
+		putInt(fp, pool->nSrcs);
+		for (pc = 0; pc < 2 * pool->nSrcs; pc++)
+			putInt(fp, ctx->poolSrcs[2 * pool->from + pc]);
+	}
+
+	if (ferror(fp) | fclose(fp))
+		remove(tmp);
+	else
+		rename(tmp, cacheName(ctx));
+}
+
+// Read the cache into c, a copy of the context; NO if it is not to be had.
+static int
+	loadCache(Context *c, CacheIn *in)
+{
+	int ii, pp, ms, hh;
+	long nMSS, nVar, nSets, nPiece, nPars, nn;
+
+	c->Root = getArenaStr(c, in);
+	c->lineno = getInt(in);
+	c->token_lineno = getInt(in);
+	{
+		char *lemma = getStr(in);
+		snprintf(c->lemma, dimof(c->lemma), "%s", (lemma) ? lemma : "");
+		free(lemma);
+	}
+	c->didChron = getInt(in);
+	c->wvar = getInt(in);
+
+	nMSS = getCount(in, in->end - in->p);
+	if (in->bad || nMSS == 0)
+		return NO;
+	c->mss = new(nMSS, Witness);
+	assert( c->mss );
+	for (ms = 0; ms < nMSS; ms++) {
+		Witness *w = &c->mss[ms];
+		w->name = getArenaStr(c, in);
+		w->Aland = getArenaStr(c, in);
+		w->pname = getArenaStr(c, in);
+		w->corrected = getInt(in);
+		if (in->bad || !w->name || !w->Aland || !w->pname)
+			return NO;
+	}
+	c->nMSS = nMSS;
+	c->macWords = BITWORDS(c->nMSS);
+
+	nVar = getCount(in, in->end - in->p);
+	if (nVar > 0)
+		growVars(c, nVar-1);
+	for (ii = 0; ii < nVar; ii++) {
+		c->nRdgs[ii] = getInt(in);
+		c->wgts[ii] = getInt(in);
+	}
+	nn = getCount(in, in->end - in->p);
+	c->vrAt = (size_t *) 0;
+	c->nVr = c->maxVr = 0;
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		c->vrAt = growArray(c->vrAt, &c->maxVr, c->nVr+1, sizeof (size_t));
+		c->vrAt[c->nVr] = getNum(in);
+		if (c->vrAt[c->nVr++] >= c->mssLen)
+			in->bad = YES;
+	}
+	nSets = getCount(in, in->end - in->p);
+	if (nSets > 0)
+		growSets(c, nSets-1);
+	for (ii = 0; ii < nSets; ii++)
+		c->states[ii] = getInterned(c, in);
+	nPiece = getCount(in, in->end - in->p);
+	if (in->bad)
+		return NO;
+
+	// Pieces first, so that initParallel() sizes the hands' sets.
+	c->nParallels = 0;
+	if (nPiece > 0)
+		growPieces(c, nPiece-1);
+	for (ii = 0; ii < nPiece; ii++) {
+		c->pieceUnits[ii] = getInt(in);
+		c->pieceVar[ii] = getInt(in);
+		c->pieceSet[ii] = getCount(in, nSets);
+	}
+
+	nPars = getCount(in, dimof(c->par));
+	c->parallel = getCount(in, nPars - 1);
+	if (in->bad || nPars == 0)
+		return NO;
+	c->nParallels = nPars;
+	for (pp = 0; pp < nPars; pp++) {
+		Parallel *para = &c->par[pp];
+		char *position;
+
+		initParallel(c, para, getInt(in));
+		position = getStr(in);
+		snprintf(para->position, dimof(para->position), "%s", (position) ? position : "");
+		free(position);
+		for (ii = 0; ii < MAXMACRO && !in->bad; ii++) {
+			Macro *m = para->pMacros[ii];
+			int ww;
+
+			if (!getInt(in))
+				continue;
+			if (!m)
+				m = para->pMacros[ii] = newMacro(c);
+			m->level = getInt(in);
+			for (ww = 0; ww < c->macWords; ww++)
+				m->inset[ww] = getNum(in);
+		}
+
+		for (ms = 0; ms < nMSS && !in->bad; ms++)
+		for (hh = 0; hh < MAXHAND && !in->bad; hh++) {
+			Hand *h = &para->msHands[ms][hh];
+			int nn;
+
+			h->earliest = getInt(in);
+			h->average = getInt(in);
+			h->latest = getInt(in);
+			h->suppressed = getInt(in);
+			h->mandated = getInt(in);
+			h->inLacuna = getInt(in);
+			h->lastHand = getCount(in, MAXHAND-1);
+			h->nExtant = getInt(in);
+
+			nn = getCount(in, nPiece);
+			for (ii = 0; ii < nn && !in->bad; ii++) {
+				int pc = (hh == 0) ? ii : getCount(in, nPiece-1);
+				int set = getCount(in, nSets);
+
+				if (set == 0)
+					continue;
+				set += c->pieceSet[pc] - 1;
+				if (set >= nSets) {
+					in->bad = YES;
+					break;
+				}
+				if (hh == 0)
+					h->sets[pc] = c->states[set];
+				else if (h->nPcs == 0 || h->pcs[h->nPcs-1] < pc)
+					correctorSet(h, pc, c->states[set]);
+				else {
+					in->bad = YES;
+					break;
+				}
+			}
+		}
+	}
+
+	nn = getCount(in, in->end - in->p);
+	c->pools = (Pool *) 0;
+	c->poolSrcs = (int *) 0;
+	c->nPools = c->maxPools = c->nPoolSrcs = c->maxPoolSrcs = 0;
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		Pool *pool;
+		int nSrcs, jj;
+
+		c->pools = growArray(c->pools, &c->maxPools, c->nPools+1, sizeof (Pool));
+		pool = &c->pools[c->nPools++];
+		pool->parallel = getCount(in, nPars-1);
+		pool->ms = getCount(in, nMSS-1);
+		pool->from = c->nPoolSrcs / 2;
+		pool->nSrcs = 0;
+		nSrcs = getCount(in, in->end - in->p);
+		for (jj = 0; jj < nSrcs && !in->bad; jj++) {
+			ms = getCount(in, nMSS-1);
+			hh = getInt(in);
+			if (hh < -1 || hh >= MAXHAND)
+				in->bad = YES;
+			poolSrc(c, ms, hh);
+		}
+	}
+	if (in->bad || in->p != in->end)
+		return NO;
+
+	c->nVar = c->var = nVar;
+	c->nSets = c->set = nSets;
+	c->nPiece = nPiece;
+	c->piece = nPiece - 1;
+	indexMSS(c);
+	return YES;
+}
+
+// Take the parse from base.prepc if it is there and still current.
+static int
+	readCache(Context *ctx)
+{
+	uint64_t key[3];
+	char *buf, *root;
+	Context c[1];
+	CacheIn in[1];
+	struct stat st;
+	FILE *fp;
+	int ii, pp, ok;
+
+	if (!caching(ctx))
+		return NO;
+	if (!(fp = fopen(cacheName(ctx), "rb")))
+		return NO;
+	if (fstat(fileno(fp), &st) < 0 || !(buf = new(st.st_size + 1, char))) {
+		fclose(fp);
+		return NO;
+	}
+	in->p = (unsigned char *) buf;
+	in->end = in->p + fread(buf, 1, st.st_size, fp);
+	in->bad = NO;
+	fclose(fp);
+
+	// The keys
+	ok = (in->end - in->p > strlen(CACHEMAGIC)
+		&& memcmp(buf, CACHEMAGIC, strlen(CACHEMAGIC)) == 0);
+	in->p += strlen(CACHEMAGIC);
+	mssKey(ctx, key);
+	for (ii = 0; ii < 3; ii++)
+		ok &= (getNum(in) == key[ii]);
+	root = (ok) ? getStr(in) : (char *) 0;
+	ok &= (!root == !getenv("ROOT")) && (!root || strcmp(root, getenv("ROOT")) == 0);
+	free(root);
+	ok &= (getInt(in) == ctx->weighByED);
+	ok &= (getInt(in) == ctx->autoED);
+	c->nChron = (ok) ? getCount(in, in->end - in->p) : 0;
+	c->chronFiles = calloc(c->nChron + 1, sizeof (char *));
+	assert( c->chronFiles );
+	for (ii = 0; ii < c->nChron && ok; ii++) {
+		uint64_t ck[3];
+		int kk;
+
+		c->chronFiles[ii] = getStr(in);
+		ok &= (c->chronFiles[ii] && fileKey(c->chronFiles[ii], ck));
+		for (kk = 0; kk < 3; kk++)
+			ok &= (getNum(in) == ck[kk]);
+	}
+
+	if (ok && !in->bad) {
+		int nChron = c->nChron;
+		char **chronFiles = c->chronFiles;
+
+		*c = *ctx;
+		c->nChron = nChron;
+		c->chronFiles = chronFiles;
+		ok = loadCache(c, in);
+		if (ok)
+			*ctx = *c;
+		else {
+			// What a failed load leaves behind is dropped, but for
+			// the macro tables, which the copy shares, and the arena
+			// and its strings, which it may have grown.
+			for (pp = 0; pp < dimof(ctx->par); pp++)
+				memset(ctx->par[pp].pMacros, 0, MAXMACRO * sizeof (Macro *));
+			ctx->arena = c->arena;
+			ctx->interned = c->interned;
+			ctx->internMask = c->internMask;
+			ctx->nInterned = c->nInterned;
+		}
+	} else {
+		for (ii = 0; ii < c->nChron; ii++)
+			free(c->chronFiles[ii]);
+		free(c->chronFiles);
+		ok = NO;
+	}
+	free(buf);
+	return ok;
+}
+
+/* ------------------------------------------------------
+||
+||  Incremental parse:  base.prepb keeps what each @ block (from one @
+||  up to the next) did to the parse.  A block can be replayed instead
+||  of parsed when its text and the state it starts in are unchanged.
+||  That state is summed up by a hash chained over the text of every
+||  stateful command (* = % ~ ^ - &) so far, Chron files included, with
+||  ROOT, WEIGHBYED and AUTOED, and by the current parallel; blocks
+||  that hold stateful commands themselves are not kept, but for %.
+||  Units, pieces and sets are numbered from the start of the block, so
+||  they stay good when blocks before them change.  A block kept is
+||  replayed by copying the readings it left each witness it touched
+||  into place, a few pieces at a time.
+||
+*/
+
+#define BLOCKMAGIC "prepb 4\n"
+
+static void
+	chainHash(Context *ctx, const char *p, size_t n)
+{
+	ctx->chain = (ctx->chain ^ hashBytes(p, n)) * 0xFF51AFD7ED558CCDull;
+	ctx->chain ^= ctx->chain >> 29;
+}
+
+// The next top-level token, noting where the last command ended.
+static char *
+	commandToken(Context *ctx)
+{
+	ctx->blk.endPos = ctx->mssPos;
+	ctx->blk.endLine = ctx->lineno;
+	ctx->blk.endInc = ctx->inc_line_p;
+	return getToken(ctx);
+}
+
+/*
+	A stateful command, from offset from to here, goes into the chain.
+	A block with one in it is not kept, unless it is a % (its lacunae
+	are kept with the hands of the witnesses it names).
+*/
+static void
+	noteState(Context *ctx, int cmd, size_t from)
+{
+	if (!ctx->blocks)
+		return;
+	if (cmd != '%')
+		ctx->blk.dirty = YES;
+	chainHash(ctx, ctx->mssBuf + from, ctx->mssPos - from);
+	if (cmd == '^') {
+		uint64_t key[3];
+		if (ctx->nChron > 0 && fileKey(ctx->chronFiles[ctx->nChron-1], key))
+			chainHash(ctx, (char *) key, sizeof key);
+	}
+}
+
+// Note that the block touches witness ms (of the current parallel),
+// whose hands blockEffects() will take what it did from; all, if it
+// touches more than the original hand's readings.
+static void
+	noteHand(Context *ctx, int ms, int all)
+{
+	BlockRec *b = &ctx->blk;
+	int at = ctx->parallel * ctx->nMSS + ms;
+
+	if (!b->open || b->dirty)
+		return;
+	if (2*at+1 >= b->maxSeen) {
+		int old = b->maxSeen, ii;
+		b->seen = growArray(b->seen, &b->maxSeen, 2*at+2, sizeof (int));
+		for (ii = old; ii < b->maxSeen; ii++)
+			b->seen[ii] = -1;
+	}
+	if (all)
+		b->seen[2*at+1] = YES;
+	if (b->seen[2*at] >= 0)
+		return;
+	b->seen[2*at] = ctx->par[ctx->parallel].msHands[ms][0].nExtant;
+	b->touched = growArray(b->touched, &b->maxTouched, b->nTouched+1, sizeof (int));
+	b->touched[b->nTouched++] = at;
+}
+
+static void
+	noteAssign(Context *ctx, int ms, int hh, char *rdgs)
+{
+	BlockRec *b = &ctx->blk;
+
+	if (ctx->piece < b->piece || (rdgs && ctx->set-1 < b->set))
+		b->dirty = YES;		// Reaches back before the block
+	else
+		noteHand(ctx, ms, hh > 0);
+}
+
+// Forget the hands the last block touched.
+static void
+	clearTouched(BlockRec *b)
+{
+	int ii;
+
+	for (ii = 0; ii < b->nTouched; ii++)
+		b->seen[2*b->touched[ii]] = b->seen[2*b->touched[ii]+1] = -1;
+	b->nTouched = 0;
+}
+
+// Key of the block starting here:  the chain, the parallel and the verse.
+static uint64_t
+	blockKey(Context *ctx)
+{
+	const char *p = ctx->mssBuf + ctx->mssPos, *end = ctx->mssBuf + ctx->mssLen;
+	const char *verse;
+	uint64_t key;
+
+	while (p < end && IsSpace[(unsigned char) *p])
+		p++;
+	for (verse = p; p < end && !IsSpace[(unsigned char) *p]; p++)
+		;
+	key = (ctx->chain ^ (uint64_t) ctx->parallel * 0x9E3779B97F4A7C15ull) * 0xFF51AFD7ED558CCDull;
+	return key ^ hashBytes(verse, p - verse);
+}
+
+static void
+	addBlock(Context *ctx, Block *b)
+{
+	ctx->newBlocks = growArray(ctx->newBlocks, &ctx->maxNew, ctx->nNew+1, sizeof (Block));
+	ctx->newBlocks[ctx->nNew++] = *b;
+}
+
+// Readings r of piece pc, as the set they are relative to the piece's
+// first (1 on for it and after, 0 and down before it), or 0 for none.
+static int
+	setCode(Context *ctx, BlockRec *b, int pc, char *r)
+{
+	int set;
+
+	if (!r)
+		return 0;
+	for (set = ctx->pieceSet[pc]; set < ctx->set; set++) {
+		if (ctx->states[set] == r)
+			return set - ctx->pieceSet[pc] + 1;
+	}
+	for (set = ctx->pieceSet[pc] - 1; set >= b->set; set--) {
+		if (ctx->states[set] == r)
+			break;
+	}
+	assert( set >= b->set );
+	return set - ctx->pieceSet[pc];
+}
+
+// Hash the sets of piece pc into b->slots, for pieceCode(); the mask is returned.
+static unsigned
+	hashPiece(Context *ctx, BlockRec *b, int pc)
+{
+	int end = (pc < ctx->piece) ? ctx->pieceSet[pc+1] : ctx->set;
+	int set, need;
+	unsigned mask;
+
+	for (need = 16; need < 2 * (end - ctx->pieceSet[pc]); need *= 2)
+		;
+	b->slots = growArray(b->slots, &b->maxSlots, need, sizeof (int));
+	mask = need - 1;
+	memset(b->slots, -1, need * sizeof (int));
+	for (set = ctx->pieceSet[pc]; set < end; set++) {
+		unsigned slot = ((uintptr_t) ctx->states[set] >> 3) * 0x9E3779B1u & mask;
+
+		while (b->slots[slot] >= 0 && ctx->states[b->slots[slot]] != ctx->states[set])
+			slot = (slot + 1) & mask;
+		if (b->slots[slot] < 0)
+			b->slots[slot] = set;
+	}
+	return mask;
+}
+
+// setCode(), by the sets of piece pc as hashPiece() left them
+static int
+	pieceCode(Context *ctx, BlockRec *b, int pc, unsigned mask, char *r)
+{
+	unsigned slot = ((uintptr_t) r >> 3) * 0x9E3779B1u & mask;
+
+	for ( ; r && b->slots[slot] >= 0; slot = (slot + 1) & mask) {
+		if (ctx->states[b->slots[slot]] == r)
+			return b->slots[slot] - ctx->pieceSet[pc] + 1;
+	}
+	return setCode(ctx, b, pc, r);
+}
+
+// The readings setCode() gave as code for piece pc, in a block whose sets start at set0
+static char *
+	codeSet(Context *ctx, CacheIn *in, int pc, int set0, int code)
+{
+	long set = ctx->pieceSet[pc] + ((code > 0) ? code - 1 : code);
+
+	if (code == 0)
+		return (char *) 0;
+	if (set < set0 || set >= ctx->set) {
+		in->bad = YES;
+		return (char *) 0;
+	}
+	return ctx->states[set];
+}
+
+// The hands of witness at (pp * nMSS + ms)
+static Hand *
+	touchedHands(Context *ctx, int at)
+{
+	return ctx->par[at / ctx->nMSS].msHands[at % ctx->nMSS];
+}
+
+// A block's hands in lacuna (a bit a hand), and correctors with readings in it (8 up)
+static int
+	handBits(Hand *hands, BlockRec *b)
+{
+	int bits = 0, hh;
+
+	for (hh = 0; hh < MAXHAND; hh++) {
+		Hand *h = &hands[hh];
+
+		if (h->inLacuna)
+			bits |= 1 << hh;
+		if (hh > 0 && h->nPcs > 0 && h->pcs[h->nPcs-1] >= b->piece)
+			bits |= 1 << (MAXHAND + hh);
+	}
+	return bits;
+}
+
+// A column of n numbers, as the commonest (near enough) and those that differ
+static void
+	putColumn(FILE *fp, int *v, int n)
+{
+	int ii, last, nOdd, best = 0, votes = 0;
+
+	for (ii = 0; ii < n; ii++) {	// (Boyer-Moore majority vote)
+		if (votes == 0)
+			best = v[ii];
+		votes += (v[ii] == best) ? 1 : -1;
+	}
+	for (ii = nOdd = 0; ii < n; ii++)
+		nOdd += (v[ii] != best);
+	putInt(fp, best);
+	putInt(fp, nOdd);
+	for (ii = last = 0; ii < n; ii++) {
+		if (v[ii] != best) {
+			putInt(fp, ii - last);
+			putInt(fp, v[ii]);
+			last = ii;
+		}
+	}
+}
+
+static void
+	getColumn(CacheIn *in, int *v, int n)
+{
+	int best = getInt(in), nOdd = getCount(in, n), ii, at;
+
+	for (ii = 0; ii < n; ii++)
+		v[ii] = best;
+	for (ii = at = 0; ii < nOdd && !in->bad; ii++) {
+		at += getCount(in, n - 1 - at);
+		v[at] = getInt(in);
+	}
+}
+
+#define PIECEBATCH 8			// Pieces of a witness taken at once (a cache line)
+
+/*
+	What the block b did to the parse, as replayBlock() reads it:  its
+	units, pieces and states; the witnesses it touched, and a column for
+	each of how their nExtant moved, their handBits(), and the readings
+	of their original hands for each piece, with the readings their
+	correctors took between; and the chain after it.
+*/
+static void
+	blockEffects(Context *ctx, BlockRec *b, Block *nb)
+{
+	FILE *fp;
+	char *fx;
+	int ii, pp, pc, hh, nn;
+	int nPiece = ctx->piece + 1 - b->piece;
+	int *codes;
+
+	fp = open_memstream(&fx, &nb->fxLen);
+	assert( fp );
+	putInt(fp, ctx->var - b->var);
+	for (ii = b->var; ii < ctx->var; ii++) {
+		putInt(fp, ctx->nRdgs[ii]);
+		putInt(fp, ctx->wgts[ii]);
+	}
+	putInt(fp, nPiece);
+	for (ii = b->piece; ii <= ctx->piece; ii++) {
+		putInt(fp, ctx->pieceUnits[ii]);
+		putInt(fp, ctx->pieceVar[ii] - b->var);
+		putInt(fp, ctx->pieceSet[ii] - b->set);
+	}
+	putInt(fp, ctx->set - b->set);
+	for (ii = b->set; ii < ctx->set; ii++)
+		putStr(fp, ctx->states[ii]);
+
+	putInt(fp, b->nTouched);
+	for (ii = 0; ii < b->nTouched; ii++)
+		putInt(fp, b->touched[ii] - ((ii > 0) ? b->touched[ii-1] : 0));
+	b->rows = growArray(b->rows, &b->maxRows, b->nTouched, sizeof (Hand *));
+	b->codes = growArray(b->codes, &b->maxCodes, b->nTouched, sizeof (int));
+	codes = b->codes;
+	for (ii = 0; ii < b->nTouched; ii++) {
+		b->rows[ii] = touchedHands(ctx, b->touched[ii]);
+		codes[ii] = b->rows[ii][0].nExtant - b->seen[2*b->touched[ii]];
+	}
+	putColumn(fp, codes, b->nTouched);
+	for (ii = 0; ii < b->nTouched; ii++)
+		codes[ii] = (b->seen[2*b->touched[ii]+1] > 0) ? handBits(b->rows[ii], b) : -1;
+	putColumn(fp, codes, b->nTouched);
+	for (ii = 0; ii < b->nTouched; ii++) {
+		Hand *hands = b->rows[ii];
+
+		for (hh = 1; hh < MAXHAND && codes[ii] > 0; hh++) {
+			Hand *h = &hands[hh];
+
+			if (!(codes[ii] & (1 << (MAXHAND + hh))))
+				continue;
+			for (nn = h->nPcs; nn > 0 && h->pcs[nn-1] >= b->piece; nn--)
+				;
+			putInt(fp, h->nPcs - nn);
+			for ( ; nn < h->nPcs; nn++) {
+				putInt(fp, h->pcs[nn] - b->piece);
+				putInt(fp, setCode(ctx, b, h->pcs[nn], h->pcSets[nn]));
+			}
+		}
+	}
+	// (A few pieces at a time, taken a witness at a time)
+	b->grid = growArray(b->grid, &b->maxGrid, b->nTouched * PIECEBATCH, sizeof (char *));
+	for (pc = b->piece; pc <= ctx->piece; pc += PIECEBATCH) {
+		int np = (ctx->piece + 1 - pc < PIECEBATCH) ? ctx->piece + 1 - pc : PIECEBATCH;
+
+		for (ii = 0; ii < b->nTouched; ii++) {
+			char **sets = b->rows[ii][0].sets + pc;
+			for (nn = 0; nn < np; nn++)
+				b->grid[nn * b->nTouched + ii] = sets[nn];
+		}
+		for (nn = 0; nn < np; nn++) {
+			char **col = &b->grid[nn * b->nTouched];
+			unsigned mask = hashPiece(ctx, b, pc + nn);
+			int code = 0;
+
+			for (ii = 0; ii < b->nTouched; ii++) {
+				if (ii == 0 || col[ii] != col[ii-1])
+					code = pieceCode(ctx, b, pc + nn, mask, col[ii]);
+				codes[ii] = code;
+			}
+			putColumn(fp, codes, b->nTouched);
+		}
+	}
+	putInt(fp, ctx->nVr - b->vr);
+	for (ii = b->vr; ii < ctx->nVr; ii++)
+		putInt(fp, ctx->vrAt[ii] - b->start);
+	putInt(fp, ctx->parallel);
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		int moved = strcmp(b->position[pp], ctx->par[pp].position) != 0;
+		putInt(fp, moved);
+		if (moved)
+			putStr(fp, ctx->par[pp].position);
+	}
+	putStr(fp, (nPiece > 0) ? ctx->lemma : (char *) 0);
+	putNum(fp, ctx->chain);
+	fclose(fp);
+	nb->fx = (unsigned char *) fx;
+}
+
+// Close the block being parsed, keeping its effects if it can be replayed.
+static void
+	endBlock(Context *ctx)
+{
+	BlockRec *b = &ctx->blk;
+	Block nb;
+
+	if (!b->open)
+		return;
+	b->open = NO;
+	if (b->dirty || !IsSpace[(unsigned char) ctx->mssBuf[b->endPos-1]])
+		return;		// (Text added after it could run into its last token)
+
+	blockEffects(ctx, b, &nb);
+	nb.key = b->key;
+	nb.hash = hashBytes(ctx->mssBuf + b->start, b->endPos - b->start);
+	nb.len = b->endPos - b->start;
+	nb.lines = b->endLine - b->lineno;
+	nb.tokenLine = ctx->token_lineno - b->lineno;
+	nb.incLine = b->endInc;
+	addBlock(ctx, &nb);
+}
+
+// Apply the effects of a kept block, starting at start, as parsing it would have.
+static int
+	replayBlock(Context *ctx, Block *old, size_t start)
+{
+	BlockRec *b = &ctx->blk;
+	CacheIn in[1];
+	int var0 = ctx->var, piece0 = ctx->piece + 1, set0 = ctx->set;
+	int ii, jj, nn, pp, pc, hh, at;
+	int *codes;
+
+	in->p = old->fx;
+	in->end = old->fx + old->fxLen;
+	in->bad = NO;
+
+	nn = getCount(in, old->fxLen);
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		int var = ctx->var++;
+		growVars(ctx, var);
+		ctx->nRdgs[var] = getInt(in);
+		ctx->wgts[var] = getInt(in);
+		ctx->wvar += ctx->wgts[var];
+	}
+	nn = getCount(in, old->fxLen);
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		ctx->piece++;
+		growPieces(ctx, ctx->piece);
+		ctx->pieceUnits[ctx->piece] = getInt(in);
+		ctx->pieceVar[ctx->piece] = var0 + getInt(in);
+		ctx->pieceSet[ctx->piece] = set0 + getInt(in);
+	}
+	nn = getCount(in, old->fxLen);
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		int set = ctx->set++;
+		growSets(ctx, set);
+		ctx->states[set] = getInterned(ctx, in);
+	}
+	// The hands, a column at a time
+	nn = getCount(in, ctx->nParallels * ctx->nMSS);
+	b->rows = growArray(b->rows, &b->maxRows, nn, sizeof (Hand *));
+	b->codes = growArray(b->codes, &b->maxCodes, nn, sizeof (int));
+	codes = b->codes;
+	for (ii = 0, at = 0; ii < nn && !in->bad; ii++) {
+		at += getInt(in);
+		if (at < 0 || at >= ctx->nParallels * ctx->nMSS)
+			in->bad = YES;
+		else
+			b->rows[ii] = touchedHands(ctx, at);
+	}
+	getColumn(in, codes, nn);
+	for (ii = 0; ii < nn && !in->bad; ii++)
+		b->rows[ii][0].nExtant += codes[ii];
+	getColumn(in, codes, nn);
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		Hand *hands = b->rows[ii];
+
+		if (codes[ii] < 0)
+			continue;
+		for (hh = 0; hh < MAXHAND; hh++)
+			hands[hh].inLacuna = (codes[ii] >> hh) & 1;
+		for (hh = 1; hh < MAXHAND && !in->bad; hh++) {
+			Hand *h = &hands[hh];
+			int nPcs;
+
+			if (!(codes[ii] & (1 << (MAXHAND + hh))))
+				continue;
+			nPcs = getCount(in, ctx->piece + 1 - piece0);
+			for (jj = 0; jj < nPcs && !in->bad; jj++) {
+				char *r;
+
+				pc = piece0 + getCount(in, ctx->piece - piece0);
+				r = codeSet(ctx, in, pc, set0, getInt(in));
+				if (h->nPcs > 0 && h->pcs[h->nPcs-1] >= pc)
+					in->bad = YES;
+				else if (!in->bad)
+					correctorSet(h, pc, r);
+			}
+		}
+	}
+	b->grid = growArray(b->grid, &b->maxGrid, nn * PIECEBATCH, sizeof (char *));
+	for (pc = piece0; pc <= ctx->piece && !in->bad; pc += PIECEBATCH) {
+		int np = (ctx->piece + 1 - pc < PIECEBATCH) ? ctx->piece + 1 - pc : PIECEBATCH;
+
+		for (jj = 0; jj < np; jj++) {
+			char **col = &b->grid[jj * nn];
+
+			getColumn(in, codes, nn);
+			for (ii = 0; ii < nn; ii++) {
+				col[ii] = (ii > 0 && codes[ii] == codes[ii-1]) ? col[ii-1]
+					: codeSet(ctx, in, pc + jj, set0, codes[ii]);
+			}
+		}
+		for (ii = 0; ii < nn && !in->bad; ii++) {
+			char **sets = b->rows[ii][0].sets + pc;
+			for (jj = 0; jj < np; jj++)
+				sets[jj] = b->grid[jj * nn + ii];
+		}
+	}
+	nn = getCount(in, old->fxLen);
+	for (ii = 0; ii < nn && !in->bad; ii++) {
+		ctx->vrAt = growArray(ctx->vrAt, &ctx->maxVr, ctx->nVr+1, sizeof (size_t));
+		ctx->vrAt[ctx->nVr++] = start + getCount(in, old->len - 1);
+	}
+	ctx->parallel = getCount(in, ctx->nParallels-1);
+	for (pp = 0; pp < ctx->nParallels && !in->bad; pp++) {
+		if (getInt(in)) {
+			char *position = getStr(in);
+			if (position)
+				snprintf(ctx->par[pp].position, dimof(ctx->par[pp].position), "%s", position);
+			free(position);
+		}
+	}
+	{
+		char *lemma = getStr(in);
+		if (lemma)
+			snprintf(ctx->lemma, dimof(ctx->lemma), "%s", lemma);
+		free(lemma);
+	}
+	ctx->chain = getNum(in);
+	return !in->bad && in->p == in->end;
+}
+
+/*
+	At each top-level @ or !, close the block being parsed; at an @,
+	replay the block from the last parse if it is still good, moving
+	the tokenizer past it (and returning YES), or else start a new one.
+*/
+static int
+	markBlock(Context *ctx, char *token)
+{
+	BlockRec *b = &ctx->blk;
+	uint64_t key;
+	unsigned slot;
+	int pp;
+
+	if (!ctx->blocks || (*token != '@' && *token != '!'))
+		return NO;
+	endBlock(ctx);
+	if (*token != '@')
+		return NO;
+
+	key = blockKey(ctx);
+	for (slot = key & ctx->oldMask; ctx->oldIndex && ctx->oldIndex[slot] != NOMSS;
+			slot = (slot + 1) & ctx->oldMask) {
+		Block *old = &ctx->oldBlocks[ctx->oldIndex[slot]];
+		size_t start = ctx->tokp - ctx->mssBuf;
+
+		if (old->key != key || old->len > ctx->mssLen - start
+		|| old->hash != hashBytes(ctx->tokp, old->len))
+			continue;
+		if (!replayBlock(ctx, old, start)) {
+			fprintf(stderr, "Damaged block in %s.prepb\n", ctx->base);
+			exit(-FATAL);
+		}
+		ctx->mssPos = start + old->len;
+		ctx->token_lineno = ctx->lineno + old->tokenLine;
+		ctx->lineno += old->lines;
+		ctx->inc_line_p = old->incLine;
+		addBlock(ctx, old);
+		return YES;
+	}
+
+	b->open = YES;
+	b->dirty = NO;
+	b->key = key;
+	b->start = ctx->tokp - ctx->mssBuf;
+	b->lineno = ctx->lineno;
+	b->var = ctx->var;
+	b->piece = ctx->piece + 1;
+	b->set = ctx->set;
+	b->vr = ctx->nVr;
+	clearTouched(b);
+	for (pp = 0; pp < ctx->nParallels; pp++)
+		strcpy(b->position[pp], ctx->par[pp].position);
+	return NO;
+}
+
+// Start keeping blocks, with those of the last parse to hand.
+static int
+	openBlocks(Context *ctx)
+{
+	char fn[MAXTOKEN*2];
+	char *root = getenv("ROOT");
+	CacheIn in[1];
+	struct stat st;
+	FILE *fp;
+	int ii, slots;
+
+	if (!caching(ctx))
+		return NO;
+	ctx->blocks = YES;
+	ctx->chain = 0;
+	chainHash(ctx, (root) ? root : "", (root) ? strlen(root) + 1 : 0);
+	chainHash(ctx, (char *) &ctx->weighByED, sizeof ctx->weighByED);
+	chainHash(ctx, (char *) &ctx->autoED, sizeof ctx->autoED);
+
+	snprintf(fn, dimof(fn), "%s.prepb", ctx->base);
+	if (!(fp = fopen(fn, "rb")))
+		return YES;
+	if (fstat(fileno(fp), &st) < 0 || !(ctx->oldBuf = new(st.st_size + 1, char))) {
+		fclose(fp);
+		return YES;
+	}
+	in->p = (unsigned char *) ctx->oldBuf;
+	ctx->oldLen = fread(ctx->oldBuf, 1, st.st_size, fp);
+	in->end = in->p + ctx->oldLen;
+	in->bad = NO;
+	fclose(fp);
+	if (in->end - in->p < strlen(BLOCKMAGIC)
+	|| memcmp(in->p, BLOCKMAGIC, strlen(BLOCKMAGIC)) != 0)
+		return YES;
+	in->p += strlen(BLOCKMAGIC);
+
+	ctx->nOld = getCount(in, in->end - in->p);
+	ctx->oldBlocks = new(ctx->nOld + 1, Block);
+	assert( ctx->oldBlocks );
+	for (ii = 0; ii < ctx->nOld && !in->bad; ii++) {
+		Block *b = &ctx->oldBlocks[ii];
+		b->key = getNum(in);
+		b->hash = getNum(in);
+		b->len = getNum(in);
+		b->lines = getInt(in);
+		b->tokenLine = getInt(in);
+		b->incLine = getInt(in);
+		b->fxLen = getNum(in);
+		b->fx = (unsigned char *) in->p;
+		if (b->fxLen > (size_t) (in->end - in->p))
+			in->bad = YES;
+		else
+			in->p += b->fxLen;
+	}
+	if (in->bad) {
+		ctx->nOld = 0;
+		return YES;
+	}
+
+	for (slots = 16; slots < 2 * ctx->nOld; slots *= 2)
+		;
+	ctx->oldMask = slots - 1;
+	ctx->oldIndex = new(slots, int);
+	assert( ctx->oldIndex );
+	for (ii = 0; ii < slots; ii++)
+		ctx->oldIndex[ii] = NOMSS;
+	for (ii = 0; ii < ctx->nOld; ii++) {
+		unsigned slot = ctx->oldBlocks[ii].key & ctx->oldMask;
+		while (ctx->oldIndex[slot] != NOMSS)
+			slot = (slot + 1) & ctx->oldMask;
+		ctx->oldIndex[slot] = ii;
+	}
+	return YES;
+}
+
+static void
+	writeBlocks(Context *ctx)
+{
+	char fn[MAXTOKEN*2], tmp[MAXTOKEN*2+1];
+	FILE *fp;
+	int ii;
+
+	if (!ctx->blocks)
+		return;
+	snprintf(fn, dimof(fn), "%s.prepb", ctx->base);
+	snprintf(tmp, dimof(tmp), "%s~", fn);
+	if (!(fp = fopen(tmp, "wb")))
+		return;
+	fputs(BLOCKMAGIC, fp);
+	putInt(fp, ctx->nNew);
+	for (ii = 0; ii < ctx->nNew; ii++) {
+		Block *b = &ctx->newBlocks[ii];
+		putNum(fp, b->key);
+		putNum(fp, b->hash);
+		putNum(fp, b->len);
+		putInt(fp, b->lines);
+		putInt(fp, b->tokenLine);
+		putInt(fp, b->incLine);
+		putNum(fp, b->fxLen);
+		fwrite(b->fx, 1, b->fxLen, fp);
+	}
+	if (ferror(fp) | fclose(fp))
+		remove(tmp);
+	else
+		rename(tmp, fn);
+}
+
+/* ------------------------------------------------------
+||
+||  Parallel parse (-j N):  between stateful commands (* = ~ ^ - & and
+||  !), what a stretch of @ blocks does depends only on the state at its
+||  start, less the running unit, piece and set numbers, and on the %
+||  commands before each block.  So the stretch is skimmed for where each
+||  @ and % starts and cut into chunks, which are parsed a wave at a
+||  time, a chunk a worker; a worker first applies the % of the chunks
+||  before its own.  Its units, pieces and sets are numbered from the
+||  start of the chunk, so what it leaves in its own arrays is spliced
+||  into the parse, in order, by copying them whole.  A chunk with
+||  anything to warn of, or that does not end where the skim expected,
+||  is parsed again where it stands, so warnings come out as they would
+||  without -j.
+||
+*/
+
+// Thread-local copy of ctx, with hands and parse arrays of its own
+static Context *
+	newWorker(Context *ctx)
+{
+	Context *w = new(1, Context);
+	int pp, ms, hh;
+
+	assert( w );
+	*w = *ctx;
+	memset(&w->arena, 0, sizeof w->arena);
+	w->interned = (char **) 0;
+	w->internMask = 0;
+	w->nInterned = 0;
+	w->fpErr = open_memstream(&w->errBuf, &w->errLen);
+	assert( w->fpErr );
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		Hand *block = new(ctx->nMSS * MAXHAND, Hand);
+
+		w->par[pp].msHands = new(ctx->nMSS, Hand *);
+		assert( block && w->par[pp].msHands );
+		for (ms = 0; ms < ctx->nMSS; ms++) {
+			Hand *hands = &block[ms * MAXHAND];
+			memcpy(hands, ctx->par[pp].msHands[ms], MAXHAND * sizeof (Hand));
+			for (hh = 0; hh < MAXHAND; hh++) {
+				hands[hh].sets = (char **) 0;
+				hands[hh].pcs = (int *) 0;
+				hands[hh].pcSets = (char **) 0;
+				hands[hh].nPcs = hands[hh].maxPcs = 0;
+			}
+			w->par[pp].msHands[ms] = hands;
+		}
+	}
+	w->maxVar = w->maxPiece = w->maxSets = 0;
+	w->nRdgs = w->wgts = (int *) 0;
+	w->pieceUnits = w->pieceVar = w->pieceSet = (int *) 0;
+	w->states = (char **) 0;
+	w->var = w->set = 0;
+	w->piece = -1;
+	w->blocks = NO;
+	w->atLacuna = 0;
+	w->blk.touched = w->blk.seen = w->blk.codes = w->blk.slots = (int *) 0;
+	w->blk.rows = (Hand **) 0;
+	w->blk.grid = (char **) 0;
+	w->blk.nTouched = w->blk.maxTouched = w->blk.maxSeen = 0;
+	w->blk.maxRows = w->blk.maxCodes = w->blk.maxSlots = w->blk.maxGrid = 0;
+	w->vrAt = (size_t *) 0;
+	w->nVr = w->maxVr = 0;
+	memset(&w->counts, 0, sizeof w->counts);
+	w->stats = (Stats *) 0;
+	return w;
+}
+
+// Free the worker w, but for its arena, which ctx takes over (what it
+// parsed holds states from it).
+static void
+	freeWorker(Context *ctx, Context *w)
+{
+	int pp, ms, hh;
+
+	for (pp = 0; pp < w->nParallels; pp++) {
+		for (ms = 0; ms < w->nMSS; ms++) {
+			for (hh = 0; hh < MAXHAND; hh++) {
+				free(w->par[pp].msHands[ms][hh].sets);
+				free(w->par[pp].msHands[ms][hh].pcs);
+				free(w->par[pp].msHands[ms][hh].pcSets);
+			}
+		}
+		free(w->par[pp].msHands[0]);
+		free(w->par[pp].msHands);
+	}
+	fclose(w->fpErr);
+	free(w->errBuf);
+	free(w->nRdgs);
+	free(w->wgts);
+	free(w->pieceUnits);
+	free(w->pieceVar);
+	free(w->pieceSet);
+	free(w->states);
+	free(w->blk.touched);
+	free(w->blk.seen);
+	free(w->blk.rows);
+	free(w->blk.codes);
+	free(w->blk.slots);
+	free(w->blk.grid);
+	free(w->vrAt);
+	free(w->interned);
+	adoptArena(&ctx->arena, &w->arena);
+	free(w);
+}
+
+// Clear what the last chunk left in the worker w (its hands' readings
+// all came from assignSet(), so are those of the hands it touched).
+static void
+	resetWorker(Context *w)
+{
+	int ii, hh;
+
+	for (ii = 0; ii < w->var; ii++) {
+		w->nRdgs[ii] = 0;
+		w->wgts[ii] = 1;
+	}
+	for (ii = 0; ii < w->set; ii++)
+		w->states[ii] = (char *) 0;
+	for (ii = 0; ii < w->blk.nTouched; ii++) {
+		int at = w->blk.touched[ii];
+		Hand *hands = w->par[at / w->nMSS].msHands[at % w->nMSS];
+		memset(hands[0].sets, 0, (w->piece + 1) * sizeof (char *));
+		for (hh = 1; hh < MAXHAND; hh++)
+			hands[hh].nPcs = 0;
+	}
+	clearTouched(&w->blk);
+	w->nVr = 0;
+	w->var = w->set = w->wvar = 0;
+	w->piece = -1;
+	w->nWarned = 0;
+}
+
+// Parse chunk ch in the worker w, leaving its effects in w for spliceChunk().
+static void
+	parseChunk(Context *w, Chunk *ch)
+{
+	BlockRec *b = &w->blk;
+	Status status = OK;
+	char *token;
+	int pp;
+
+	// Bring the lacunae up to where the chunk starts (what the % before
+	// it warn of was for the chunks that hold them)
+	b->open = NO;
+	for ( ; w->atLacuna < w->nLacunae && w->lacunae[w->atLacuna].pos < ch->start; w->atLacuna++) {
+		w->mssPos = w->lacunae[w->atLacuna].pos;
+		w->mssLen = ch->start;
+		w->parallel = w->lacunae[w->atLacuna].parallel;
+		if (getToken(w))
+			doLacuna(w);
+	}
+
+	resetWorker(w);
+	w->mssPos = ch->start;
+	w->mssLen = ch->end;
+	w->lineno = ch->lineno;
+	w->token_lineno = NOLINE;
+	w->inc_line_p = ch->incLine;
+	w->parallel = ch->parallel;
+	*w->lemma = EOS;
+	for (pp = 0; pp < w->nParallels; pp++)
+		*w->par[pp].position = *b->position[pp] = EOS;
+	b->open = YES;
+	b->dirty = NO;
+	b->var = b->piece = b->set = b->vr = 0;
+	b->start = ch->start;
+
+	while (status == OK && !b->dirty && (token = getToken(w))) {
+		switch (*token) {
+		default:
+			status = WARN;
+			break;
+		case '/':
+			status = doParallel(w);
+			break;
+		case '@':
+			status = doVerse(w);
+			break;
+		case '[':
+			status = doReadings(w);
+			break;
+		case '%':
+			status = doLacuna(w);
+			break;
+		case '<':		// (Its piece would be in the chunk before)
+			status = (w->piece < 0) ? WARN : doWitnesses(w);
+			break;
+		case '"':
+			status = doComment(w);
+			break;
+		case '+':
+			doEat(w);
+			break;
+		case '{':
+		case '}':
+			break;
+		}
+	}
+	b->open = NO;
+	ch->ok = (status == OK && !b->dirty && w->nWarned == 0 && w->mssPos == ch->end);
+	if (!ch->ok)
+		return;
+	while (w->atLacuna < w->nLacunae && w->lacunae[w->atLacuna].pos < ch->end)
+		w->atLacuna++;
+	ch->lines = w->lineno - ch->lineno;
+	ch->tokenLine = (w->token_lineno == NOLINE) ? -1 : (long) (w->token_lineno - ch->lineno);
+	ch->endInc = w->inc_line_p;
+}
+
+static void *
+	runWorker(void *arg)
+{
+	Context *w = (Context *) arg;
+
+	parseChunk(w, &w->chunks[w->jobAt]);
+	return arg;
+}
+
+// Parse the next wave of chunks, one a worker.
+static void
+	runWave(Context *ctx)
+{
+	int nJobs = ctx->nChunks - ctx->atChunk, ii;
+	pthread_t *tids;
+	int *started;
+
+	if (nJobs > ctx->nWorkers)
+		nJobs = ctx->nWorkers;
+	tids = new(nJobs, pthread_t);
+	started = new(nJobs, int);
+	assert( tids && started );
+	for (ii = 0; ii < nJobs; ii++) {
+		Context *w = ctx->workers[ii];
+
+		w->jobAt = ctx->atChunk + ii;
+		ctx->chunks[w->jobAt].w = w;
+		started[ii] = pthread_create(&tids[ii], (pthread_attr_t *) 0, runWorker, w) == 0;
+		if (!started[ii])
+			runWorker(w);
+	}
+	for (ii = 0; ii < nJobs; ii++) {
+		if (started[ii])
+			pthread_join(tids[ii], (void **) 0);
+	}
+	ctx->waveEnd = ctx->atChunk + nJobs;
+	free(tids);
+	free(started);
+}
+
+/*
+	Splice in what the worker made of chunk ch:  its units, pieces and
+	states, and the readings each witness it touched took, a whole row
+	at a time.  (The states stay in the worker's arena, which the
+	context takes over at endChunks().)
+*/
+static void
+	spliceChunk(Context *ctx, Chunk *ch)
+{
+	Context *w = ch->w;
+	BlockRec *b = &w->blk;
+	int var0 = ctx->var, piece0 = ctx->piece + 1, set0 = ctx->set;
+	int nPiece = w->piece + 1;
+	int ii, nn, pp, hh;
+
+	growVars(ctx, var0 + w->var);
+	for (ii = 0; ii < w->var; ii++) {
+		ctx->nRdgs[var0 + ii] = w->nRdgs[ii];
+		ctx->wgts[var0 + ii] = w->wgts[ii];
+		ctx->wvar += w->wgts[ii];
+	}
+	ctx->var += w->var;
+	growPieces(ctx, piece0 + nPiece);
+	for (ii = 0; ii < nPiece; ii++) {
+		ctx->pieceUnits[piece0 + ii] = w->pieceUnits[ii];
+		ctx->pieceVar[piece0 + ii] = var0 + w->pieceVar[ii];
+		ctx->pieceSet[piece0 + ii] = set0 + w->pieceSet[ii];
+	}
+	ctx->piece += nPiece;
+	growSets(ctx, set0 + w->set);
+	memcpy(ctx->states + set0, w->states, w->set * sizeof (char *));
+	ctx->set += w->set;
+
+	for (ii = 0; ii < b->nTouched; ii++) {
+		int at = b->touched[ii];
+		Hand *hands = touchedHands(ctx, at), *from = touchedHands(w, at);
+
+		hands[0].nExtant += from[0].nExtant - b->seen[2*at];
+		if (nPiece > 0)
+			memcpy(hands[0].sets + piece0, from[0].sets, nPiece * sizeof (char *));
+		if (b->seen[2*at+1] <= 0)
+			continue;
+		for (hh = 0; hh < MAXHAND; hh++)
+			hands[hh].inLacuna = from[hh].inLacuna;
+		for (hh = 1; hh < MAXHAND; hh++) {
+			for (nn = 0; nn < from[hh].nPcs; nn++)
+				correctorSet(&hands[hh], piece0 + from[hh].pcs[nn], from[hh].pcSets[nn]);
+		}
+	}
+
+	for (ii = 0; ii < w->nVr; ii++) {
+		ctx->vrAt = growArray(ctx->vrAt, &ctx->maxVr, ctx->nVr+1, sizeof (size_t));
+		ctx->vrAt[ctx->nVr++] = w->vrAt[ii];
+	}
+	ctx->parallel = w->parallel;
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		if (*w->par[pp].position)
+			strcpy(ctx->par[pp].position, w->par[pp].position);
+	}
+	if (nPiece > 0)
+		strcpy(ctx->lemma, w->lemma);
+}
+
+// A chunk starting at the skim's state (sk, before reading a token)
+static void
+	addChunk(Context *ctx, size_t pos, unsigned long lineno, int inc, int parallel)
+{
+	Chunk *ch;
+
+	ctx->chunks = growArray(ctx->chunks, &ctx->maxChunks, ctx->nChunks+1, sizeof (Chunk));
+	ch = &ctx->chunks[ctx->nChunks++];
+	ch->start = ch->end = pos;
+	ch->lineno = lineno;
+	ch->incLine = inc;
+	ch->parallel = parallel;
+	ch->ok = NO;
+	ch->w = (Context *) 0;
+}
+
+/*
+	Skim from here to the next stateful command but % for where each @ and %
+	starts, and cut the stretch into a few chunks a worker, for workers
+	made for it.
+*/
+static void
+	startChunks(Context *ctx)
+{
+	Context *sk = new(1, Context);
+	char *token, *err;
+	size_t errLen, pos, size;
+	int nMarks, ii, jj;
+
+	assert( sk );
+	*sk = *ctx;
+	memset(&sk->counts, 0, sizeof sk->counts);
+	sk->fpErr = open_memstream(&err, &errLen);
+	assert( sk->fpErr );
+	ctx->nChunks = ctx->atChunk = ctx->nLacunae = 0;
+	for (;;) {
+		unsigned long lineno = sk->lineno;
+		int inc = sk->inc_line_p, parallel = sk->parallel;
+
+		pos = sk->mssPos;
+		if (!(token = scanToken(sk))) {
+			pos = ctx->mssLen;
+			break;
+		}
+		if (strchr("*=~^-&!", *token))
+			break;
+		if (ctx->nChunks == 0 || *token == '@')
+			addChunk(ctx, pos, lineno, inc, parallel);
+		switch (*token) {
+		case '@':
+			scanToken(sk);
+			break;
+		case '/':
+			sk->parallel = findPar(sk, (sk->toklen > 1) ? (int) token[1] : EOS);
+			break;
+		case '%':
+			ctx->lacunae = growArray(ctx->lacunae, &ctx->maxLacunae, ctx->nLacunae+1, sizeof (Lacuna));
+			ctx->lacunae[ctx->nLacunae].pos = pos;
+			ctx->lacunae[ctx->nLacunae++].parallel = parallel;
+			SKIM(sk, token, ';');
+			break;
+		case '[':
+			SKIM(sk, token, ']');
+			break;
+		case '<':
+			while ((token = scanToken(sk)) && *token != '>') {
+				if (*token == '"')
+					SKIM(sk, token, '"');
+			}
+			break;
+		case '"':
+			SKIM(sk, token, '"');
+			break;
+		case '+':
+			SKIM(sk, token, ';');
+			break;
+		}
+		if (sk->parallel == sk->nParallels)
+			break;
+	}
+	fclose(sk->fpErr);
+	free(err);
+	addCounts(&ctx->counts, &sk->counts);
+	free(sk);
+	ctx->skimTo = pos;
+
+	// Some chunks a worker, each a run of whole @ blocks
+	nMarks = ctx->nChunks;
+	if (nMarks < 2 || ctx->nMSS == 0) {
+		ctx->nChunks = 0;
+		return;
+	}
+	size = (pos - ctx->chunks[0].start) / (4 * ctx->nJobs) + 1;
+	for (ii = jj = 0; ii < nMarks; ii++) {
+		if (ii == 0 || ctx->chunks[ii].start - ctx->chunks[jj-1].start >= size)
+			ctx->chunks[jj++] = ctx->chunks[ii];
+		ctx->chunks[jj-1].end = (ii+1 < nMarks) ? ctx->chunks[ii+1].start : pos;
+	}
+	ctx->nChunks = jj;
+
+	ctx->nWorkers = (ctx->nJobs < ctx->nChunks) ? ctx->nJobs : ctx->nChunks;
+	ctx->workers = new(ctx->nWorkers, Context *);
+	assert( ctx->workers );
+	for (ii = 0; ii < ctx->nWorkers; ii++)
+		ctx->workers[ii] = newWorker(ctx);
+	ctx->waveEnd = 0;
+}
+
+// Drop the chunks not yet spliced in, and the workers.
+static void
+	endChunks(Context *ctx)
+{
+	int ii;
+
+	for (ii = 0; ii < ctx->nWorkers; ii++) {
+		addCounts(&ctx->counts, &ctx->workers[ii]->counts);
+		freeWorker(ctx, ctx->workers[ii]);
+	}
+	free(ctx->workers);
+	ctx->workers = (Context **) 0;
+	ctx->nWorkers = 0;
+	ctx->nChunks = ctx->atChunk = ctx->waveEnd = 0;
+	ctx->skimTo = 0;
+}
+
+/*
+	At the top level, skim the next stretch and parse its next wave if
+	need be, then splice in the chunk starting here, moving the tokenizer
+	past it (and returning YES).  Chunks that could not be parsed on their own, or
+	that the parse has got out of step with, are left to the caller.
+*/
+static int
+	useChunk(Context *ctx)
+{
+	Chunk *ch;
+
+	if (ctx->atChunk >= ctx->nChunks && ctx->mssPos >= ctx->skimTo) {
+		endChunks(ctx);
+		startChunks(ctx);
+	}
+	while (ctx->atChunk < ctx->nChunks && ctx->chunks[ctx->atChunk].start < ctx->mssPos)
+		ctx->atChunk++;
+	if (ctx->atChunk >= ctx->nChunks)
+		return NO;
+	if (ctx->atChunk >= ctx->waveEnd)
+		runWave(ctx);
+
+	// (A pending newline, in inc_line_p, counts as having been counted.)
+	ch = &ctx->chunks[ctx->atChunk];
+	if (ch->start != ctx->mssPos || ch->parallel != ctx->parallel
+	|| ch->lineno + ch->incLine != ctx->lineno + ctx->inc_line_p)
+		return NO;
+	ctx->atChunk++;
+	if (!ch->ok)
+		return NO;
+	spliceChunk(ctx, ch);
+	ctx->mssPos = ch->end;
+	if (ch->tokenLine >= 0)
+		ctx->token_lineno = ch->lineno + ch->tokenLine;
+	ctx->lineno = ch->lineno + ch->lines;
+	ctx->inc_line_p = ch->endInc;
+	return YES;
+}
+
+/* ------------------------------------------------------
+||
+||  Verse ranges (--range @A-@B):  base.prepi indexes where each @ and
+||  each stateful command (* = % ~ ^ - & ! and /) starts, keyed on the
+||  collation's inode, size and mtime; a skim (as for -j) makes it when
+||  it is not current.  A range run does the stateful commands before
+||  the range where they stand, parses from the first @A up to the @
+||  after the last of @B, then does the stateful commands after it.  So
+||  witnesses, macros, lacunae and dates are as for the whole
+||  collation, and only the range's units are parsed (and numbered from
+||  its start).
+||
+*/
+
+#define INDEXMAGIC "prepi 2\n"
+
+// Parse a --range argument:  @A-@B, A-B, or @A alone.
+static int
+	setRange(Context *ctx, char *arg)
+{
+	char *from = strdup((*arg == '@') ? &arg[1] : arg), *to;
+
+	assert( from );
+	if ((to = strstr(from, "-@")))
+		*to++ = EOS;
+	else if ((to = strchr(from, '-')))
+		*to = EOS;
+	to = (to) ? to+1 : from;
+	if (!*from || !*to) {
+		fprintf(stderr, "Bad --range (use @A-@B): %s\n", arg);
+		free(from);
+		return NO;
+	}
+	ctx->rangeFrom = from;
+	ctx->rangeTo = to;
+	return YES;
+}
+
+static void
+	indexKey(Context *ctx, uint64_t key[3])
+{
+	struct stat st;
+
+	memset(key, 0, 3 * sizeof (uint64_t));
+	if (fstat(fileno(ctx->fpMss), &st) < 0)
+		return;
+	key[0] = st.st_ino;
+	key[1] = st.st_size;
+	key[2] = (uint64_t) st.st_mtim.tv_sec * 1000000000u + st.st_mtim.tv_nsec;
+}
+
+static void
+	addMark(Context *ctx, int cmd, size_t pos, unsigned long lineno, int inc, char *verse)
+{
+	Mark *m;
+
+	ctx->marks = growArray(ctx->marks, &ctx->maxMarks, ctx->nMarks+1, sizeof (Mark));
+	m = &ctx->marks[ctx->nMarks++];
+	m->cmd = cmd;
+	m->pos = pos;
+	m->lineno = lineno;
+	m->incLine = inc;
+	m->verse = verse;
+}
+
+// The marks, as base.prepi had them, if it is current.
+static int
+	readIndex(Context *ctx)
+{
+	char fn[MAXTOKEN*2];
+	uint64_t key[3];
+	CacheIn in[1];
+	struct stat st;
+	size_t pos = 0;
+	unsigned long lineno = 0;
+	FILE *fp;
+	int ii, n;
+
+	snprintf(fn, dimof(fn), "%s.prepi", ctx->base);
+	if (!(fp = fopen(fn, "rb")))
+		return NO;
+	if (fstat(fileno(fp), &st) < 0 || !(ctx->marksBuf = new(st.st_size + 1, char))) {
+		fclose(fp);
+		return NO;
+	}
+	in->p = (unsigned char *) ctx->marksBuf;
+	in->end = in->p + fread(ctx->marksBuf, 1, st.st_size, fp);
+	in->bad = NO;
+	fclose(fp);
+
+	indexKey(ctx, key);
+	if (in->end - in->p < strlen(INDEXMAGIC)
+	|| memcmp(in->p, INDEXMAGIC, strlen(INDEXMAGIC)) != 0)
+		return NO;
+	in->p += strlen(INDEXMAGIC);
+	for (ii = 0; ii < 3; ii++) {
+		if (getNum(in) != key[ii])
+			return NO;
+	}
+
+	// Positions and lines are kept as the steps from the mark before
+	n = getCount(in, in->end - in->p);
+	for (ii = 0; ii < n && !in->bad; ii++) {
+		int cmd = getCount(in, 255), inc;
+		char *verse = (char *) 0;
+
+		pos += getNum(in);
+		lineno += getNum(in);
+		inc = getCount(in, 1);
+		if (cmd == '@') {
+			uint64_t len = getNum(in);
+			if (len == 0 || len > (uint64_t) (in->end - in->p) || in->p[len-1] != EOS) {
+				in->bad = YES;
+				break;
+			}
+			verse = (char *) in->p;
+			in->p += len;
+		}
+		if (pos > ctx->mssLen)
+			in->bad = YES;
+		addMark(ctx, cmd, pos, lineno, inc, verse);
+	}
+	if (in->bad) {
+		ctx->nMarks = 0;
+		return NO;
+	}
+	return YES;
+}
+
+static void
+	writeIndex(Context *ctx)
+{
+	char fn[MAXTOKEN*2], tmp[MAXTOKEN*2+1];
+	uint64_t key[3];
+	FILE *fp;
+	int ii;
+
+	snprintf(fn, dimof(fn), "%s.prepi", ctx->base);
+	snprintf(tmp, dimof(tmp), "%s~", fn);
+	if (!(fp = fopen(tmp, "wb")))
+		return;
+	fputs(INDEXMAGIC, fp);
+	indexKey(ctx, key);
+	for (ii = 0; ii < 3; ii++)
+		putNum(fp, key[ii]);
+	putInt(fp, ctx->nMarks);
+	for (ii = 0; ii < ctx->nMarks; ii++) {
+		Mark *m = &ctx->marks[ii];
+
+		putInt(fp, m->cmd);
+		putNum(fp, m->pos - ((ii) ? m[-1].pos : 0));
+		putNum(fp, m->lineno - ((ii) ? m[-1].lineno : 0));
+		putInt(fp, m->incLine);
+		if (m->cmd == '@') {
+			size_t len = strlen(m->verse) + 1;
+			putNum(fp, len);
+			fwrite(m->verse, 1, len, fp);
+		}
+	}
+	if (ferror(fp) | fclose(fp))
+		remove(tmp);
+	else
+		rename(tmp, fn);
+}
+
+// Skim the collation from here for its marks.
+static void
+	indexMss(Context *ctx)
+{
+	Context *sk = new(1, Context);
+	char *token, *err;
+	size_t errLen;
+
+	assert( sk );
+	*sk = *ctx;
+	memset(&sk->counts, 0, sizeof sk->counts);
+	sk->fpErr = open_memstream(&err, &errLen);
+	assert( sk->fpErr );
+	ctx->nMarks = 0;
+	while (!ctx->nMarks || ctx->marks[ctx->nMarks-1].cmd != '!') {
+		unsigned long lineno = sk->lineno;
+		int inc = sk->inc_line_p, ii;
+		size_t pos = sk->mssPos;
+
+		if (!(token = getToken(sk)))
+			break;
+		switch (*token) {
+		case '@':
+			token = getToken(sk);
+			addMark(ctx, '@', pos, lineno, inc, arenaStr(&ctx->arena, (token) ? token : ""));
+			break;
+		case '/':
+		case '!':
+			addMark(ctx, *token, pos, lineno, inc, (char *) 0);
+			break;
+		case '^':
+			addMark(ctx, *token, pos, lineno, inc, (char *) 0);
+			getToken(sk);
+			break;
+		case '~':
+			addMark(ctx, *token, pos, lineno, inc, (char *) 0);
+			for (ii = 0; ii < 3 && getToken(sk); ii++)
+				;
+			break;
+		case '*':
+		case '=':
+		case '%':
+		case '-':
+		case '&':
+			addMark(ctx, *token, pos, lineno, inc, (char *) 0);
+			EAT(sk, token, ';');
+			break;
+		case '[':
+			EAT(sk, token, ']');
+			break;
+		case '<':
+			while ((token = getToken(sk)) && *token != '>') {
+				if (*token == '"')
+					EAT(sk, token, '"');
+			}
+			break;
+		case '"':
+			EAT(sk, token, '"');
+			break;
+		case '+':
+			EAT(sk, token, ';');
+			break;
+		}
+	}
+	fclose(sk->fpErr);
+	free(err);
+	addCounts(&ctx->counts, &sk->counts);
+	free(sk);
+}
+
+// Do the stateful commands among marks [from, to) where they stand.
+static Status
+	replayMarks(Context *ctx, int from, int to, int *nWarn)
+{
+	Status status = OK;
+	int ii;
+
+	for (ii = from; ii < to; ii++) {
+		Mark *m = &ctx->marks[ii];
+		char *token;
+
+		if (m->cmd == '@') {
+			snprintf(ctx->par[ctx->parallel].position, MAXTOKEN, "%s", m->verse);
+			continue;
+		}
+		ctx->mssPos = m->pos;
+		ctx->lineno = m->lineno;
+		ctx->inc_line_p = m->incLine;
+		if (!(token = commandToken(ctx)))
+			break;
+		status = command(ctx, token);
+		if (status == END || status == FATAL)
+			return status;
+		if (status == WARN)
+			++*nWarn;
+	}
+	return OK;
+}
+
+// Find the range, do what comes before it, and leave the parse at its start.
+static Status
+	startRange(Context *ctx, int *nWarn)
+{
+	Status status;
+	int start, ii, seenTo;
+
+	if (!readIndex(ctx)) {
+		free(ctx->marksBuf);
+		ctx->marksBuf = (char *) 0;
+		indexMss(ctx);
+		writeIndex(ctx);
+	}
+	for (start = 0; start < ctx->nMarks; start++) {
+		Mark *m = &ctx->marks[start];
+		if (m->cmd == '@' && strcmp(m->verse, ctx->rangeFrom) == 0)
+			break;
+	}
+	if (start == ctx->nMarks) {
+		fprintf(stderr, "No @ %s in %s\n", ctx->rangeFrom, ctx->base);
+		return FATAL;
+	}
+	seenTo = NO;
+	for (ii = start; ii < ctx->nMarks; ii++) {
+		Mark *m = &ctx->marks[ii];
+		if (m->cmd != '@')
+			continue;
+		if (strcmp(m->verse, ctx->rangeTo) == 0)
+			seenTo = YES;
+		else if (seenTo)
+			break;
+	}
+	if (!seenTo)
+		fprintf(stderr, "No @ %s after @ %s; to the end of %s\n", ctx->rangeTo, ctx->rangeFrom, ctx->base);
+	ctx->rangeEnd = ii;
+
+	status = replayMarks(ctx, 0, start, nWarn);
+	if (status == END || status == FATAL)
+		return status;
+	ctx->mssPos = ctx->marks[start].pos;
+	ctx->lineno = ctx->marks[start].lineno;
+	ctx->inc_line_p = ctx->marks[start].incLine;
+	ctx->mssEnd = ctx->mssLen;
+	if (ii < ctx->nMarks)
+		ctx->mssLen = ctx->marks[ii].pos;
+	return OK;
+}
+
+// After the range, do the stateful commands that follow it.
+static Status
+	endRange(Context *ctx, int *nWarn)
+{
+	ctx->mssLen = ctx->mssEnd;
+	return replayMarks(ctx, ctx->rangeEnd, ctx->nMarks, nWarn);
 }
 
 static FILE *
 	outFile(char *base, char *ext)
 {
-	char fn[MAXTOKEN];
+	char fn[MAXTOKEN*2];
 	FILE *fp;
 
-	sprintf(fn, "%s.%s", base, ext);
+	snprintf(fn, dimof(fn), "%s.%s", base, ext);
 
 	fp = fopen(fn, "w");
 	if (!fp)
@@ -867,199 +5170,245 @@ static FILE *
 	return fp;
 }
 
+// An output of the run:  its file, or under --watch a buffer, until closeOutputs()
+static FILE *
+	openOutput(Context *ctx, int ii, char *ext)
+{
+	FILE *fp;
+
+	if (!ctx->watching)
+		return outFile(ctx->base, ext);
+	fp = open_memstream(&ctx->outBuf[ii], &ctx->outLen[ii]);
+	assert( fp );
+	return fp;
+}
+
+// Close the outputs; under --watch, write those that differ from their files
+// (if the run was done:  a collation with warnings leaves the last ones).
+static void
+	closeOutputs(Context *ctx, int done)
+{
+	static char *exts[] = { "tx", "no", "vr", "txb", "dm", };
+	FILE *fps[] = { ctx->fpTx, ctx->fpNo, ctx->fpVr, ctx->fpTxb, ctx->fpDm };
+	int ii;
+
+	for (ii = 0; ii < dimof(fps); ii++) {
+		char fn[MAXTOKEN*2], *old;
+		size_t len = 0;
+		FILE *fp;
+
+		if (!fps[ii])
+			continue;
+		fclose(fps[ii]);
+		if (!ctx->watching)
+			continue;
+		if (!done) {
+			free(ctx->outBuf[ii]);
+			continue;
+		}
+
+		snprintf(fn, dimof(fn), "%s.%s", ctx->base, exts[ii]);
+		old = (char *) 0;
+		if ((fp = fopen(fn, "r"))) {
+			old = new(ctx->outLen[ii] + 1, char);
+			assert( old );
+			len = fread(old, 1, ctx->outLen[ii] + 1, fp);
+			fclose(fp);
+		}
+		if (!old || len != ctx->outLen[ii] || memcmp(old, ctx->outBuf[ii], len) != 0) {
+			if ((fp = outFile(ctx->base, exts[ii]))) {
+				fwrite(ctx->outBuf[ii], 1, ctx->outLen[ii], fp);
+				fclose(fp);
+				printf("Wrote %s\n", fn);
+			}
+		}
+		free(old);
+		free(ctx->outBuf[ii]);
+	}
+}
+
+// The value of option argv[*ii], stepping over it; NULL if there is none.
+static char *
+	optValue(int argc, char *argv[], int *ii)
+{
+	if (*ii+1 < argc)
+		return argv[++*ii];
+	fprintf(stderr, "%s needs a value\n", argv[*ii]);
+	return (char *) 0;
+}
+
 static int
 	initContext(Context *ctx, int argc, char *argv[])
 {
-	int ii;
-	char *token;
-	char *base;
+	int ii, nSub;
+	char *base, *arg;
 
 	if (argc < 2) {
-		fprintf(stderr, "Usage: %s ms-coll {witnesses}*\n", argv[0]);
+		fprintf(stderr, "Usage: %s {ms-coll|-} {witnesses}*\n", argv[0]);
 		fprintf(stderr, "\tFRAG={num|pct%%}  Threshold level for fragmentary witnesses (default: %s)\n", FTHRESHOLD);
 		fprintf(stderr, "\tCORR={num|pct%%}  Threshold level of corrections for inclusion (default: %s)\n", CTHRESHOLD);
 		fprintf(stderr, "\tROOT={string}    Name of root witness (default: no root)\n");
 		fprintf(stderr, "\tYEAR={num}       Year cutoff for including witnesses (default: no year suppression)\n");
+		fprintf(stderr, "\tAUTOED={num}     Weigh plain units by word edit-distance, in bins of num (default: off)\n");
+		fprintf(stderr, "\t--sweep NAME={v1,v2,...}+  Write base.<tag>.{tx,no,vr} for each combination\n");
+		fprintf(stderr, "\t                 of FRAG, CORR, YEAR or NOSING settings, from one parse\n");
+		fprintf(stderr, "\t+TAG: {witnesses}*  Write base.TAG.{tx,no,vr} for each such subset group\n");
+		fprintf(stderr, "\tCACHE=1          Keep the parse in base.prepc, and reuse it while current;\n");
+		fprintf(stderr, "\t                 else reparse only the @ blocks changed (from base.prepb)\n");
+		fprintf(stderr, "\t-j N             Parse, suppress and write on N threads\n");
+		fprintf(stderr, "\t--stats          Write the time and memory of each phase to base.stats.json\n");
+		fprintf(stderr, "\t--range @A-@B    Prepare only the verses @A to @B (indexed in base.prepi)\n");
+		fprintf(stderr, "\t--watch          Stay resident, preparing again as the collation or its\n");
+		fprintf(stderr, "\t                 Chron files change (with the parse kept as for CACHE),\n");
+		fprintf(stderr, "\t                 until the collation is removed\n");
 		return NO;
 	}
 
 	base = argv[1];
-	ctx->subset = &argv[2];
 
-	ctx->fpMss = fopen(base, "r");
-	if (!ctx->fpMss) {
-		fprintf(stderr, "Cannot open collation file: %s\n", base);
+	// The witnesses selected, less any --sweep NAME=values arguments,
+	// or the +TAG: groups of them.
+	ctx->nSweep = 0;
+	ctx->sweep = (SweepVar *) 0;
+	ctx->sweepAt = (int *) 0;
+	ctx->nGroups = 0;
+	ctx->groups = (Group *) 0;
+	ctx->nJobs = 1;
+	ctx->subset = new(argc, char *);
+	assert( ctx->subset );
+	for (ii = 2, nSub = 0; ii < argc; ii++) {
+		if (strcmp(argv[ii], "--sweep") == 0) {
+			int nSweep = ctx->nSweep;
+
+			while (ii+1 < argc && strchr(argv[ii+1], '=')) {
+				if (!addSweep(ctx, argv[++ii]))
+					return NO;
+			}
+			if (ctx->nSweep == nSweep) {
+				fprintf(stderr, "A --sweep needs NAME=values: %s\n", (ii+1 < argc) ? argv[ii+1] : "");
+				return NO;
+			}
+		} else if (strcmp(argv[ii], "--range") == 0) {
+			if (!(arg = optValue(argc, argv, &ii)) || !setRange(ctx, arg))
+				return NO;
+		} else if (strcmp(argv[ii], "-j") == 0) {
+			if (!(arg = optValue(argc, argv, &ii)))
+				return NO;
+			ctx->nJobs = atoi(arg);
+		} else if (strcmp(argv[ii], "--stats") == 0) {
+			ctx->stats = calloc(1, sizeof (Stats));
+			assert( ctx->stats );
+		} else if (addGroup(ctx, argv[ii]))
+			;
+		else if (ctx->nGroups)
+			addToGroup(ctx, argv[ii]);
+		else
+			ctx->subset[nSub++] = argv[ii];
+	}
+	ctx->subset[nSub] = (char *) 0;
+	if (ctx->nGroups && nSub) {
+		fprintf(stderr, "Witnesses must follow a +TAG: when there are groups: %s\n", ctx->subset[0]);
 		return NO;
 	}
-
-	if (!(ctx->fpTx = outFile(base, "tx")))
+	ctx->fpOut = stdout;
+	ctx->fpErr = stderr;
+	if (!openCollation(ctx, base))
 		return NO;
-
-	if (!(ctx->fpNo = outFile(base, "no")))
+	if (ctx->rangeFrom && ctx->fpMss == stdin) {
+		fprintf(stderr, "A --range needs a collation file, not stdin\n");
 		return NO;
+	}
 
-	if (!(ctx->fpVr = outFile(base, "vr")))
-		return NO;
+	// Sweeps and groups open their own output files
+	base = ctx->base;
+	if (!ctx->nSweep && !ctx->nGroups) {
+		if (!(ctx->fpTx = openOutput(ctx, 0, "tx")))
+			return NO;
 
-	ctx->Root = getenv("ROOT");
-	ctx->nMSS = (ctx->Root) ? 1 : 0;
-	ctx->nVar = 0;
-	ctx->nPiece = 0;
-	ctx->nSets = 0;
+		if (!(ctx->fpNo = openOutput(ctx, 1, "no")))
+			return NO;
 
-	ctx->nParallels = 0;
+		if (!(ctx->fpVr = openOutput(ctx, 2, "vr")))
+			return NO;
 
-	ctx->lineno = 0;
-	ctx->inc_line_p = YES;
-	for (ii = 0; ii < dimof(ctx->par); ii++)
-		strcpy(ctx->par[ii].position, "Beginning");
-	ctx->lemma[0] = EOS;
+		if (getenv("TXB") && !(ctx->fpTxb = openOutput(ctx, 3, "txb")))
+			return NO;
 
-	while ((token = getToken(ctx)) && *token != '!') {
-		switch (*token) {
-		default:
-			break;
-		case '@':
-			ctx->token_lineno = ctx->lineno;
-			token = getToken(ctx);
-			if (!token) {
-				EOFWARN(ctx, "@");
-				return NO;
-			}
-			strcpy(ctx->par[ctx->parallel].position, token);
-			break;
-		case '*':
-			// Allow ROOT= to be specified with *ROOT
-			if (!ctx->Root && token[1]) {
-				ctx->Root = strdup(token+1);
-				ctx->nMSS++;
-			}
-			ctx->token_lineno = ctx->lineno;
-			while ((token = getToken(ctx)) && *token != ';') {
-				if (*token == '"')
-					EAT(ctx, token, '"');
-				else if (*token == '/')
-					ctx->par[ctx->nParallels++].name_space = token[1];
-				else
-					ctx->nMSS++;
-			}
-			if (!token) {
-				EOFWARN(ctx, "*");
-				return NO;
-			}
-			break;
-		case '<':
-			ctx->token_lineno = ctx->lineno;
-			ctx->nSets++;
-			while ((token = getToken(ctx)) && *token != '>') {
-				if (*token == '"') {
-					EAT(ctx, token, '"');
-					if (!token) {
-						EOFWARN(ctx, "\"");
-						return NO;
-					}
-				}
-				if (*token == '|')
-					ctx->nSets++;
-			}
-			if (!token) {
-				EOFWARN(ctx, "<");
-				return NO;
-			}
-			break;
-		case '[':
-			ctx->token_lineno = ctx->lineno;
-			ctx->nPiece++;
-			while ((token = getToken(ctx)) && *token != ']') {
-				if (*token == '"') {
-					EAT(ctx, token, '"');
-					if (!token) {
-						EOFWARN(ctx, "\"");
-						return NO;
-					}
-				}
-				if (*token == '|')
-					ctx->nVar++;
-			}
-			if (!token) {
-				EOFWARN(ctx, "[");
-				return NO;
-			}
-			break;
-		case '"':
-			ctx->token_lineno = ctx->lineno;
-			EAT(ctx, token, '"');
-			if (!token) {
-				EOFWARN(ctx, "\"");
-				return NO;
-			}
-			break;
-#if 0
-		case '~':
-			// Eat aliases, which could start with control token start
-			getToken(ctx);
-			getToken(ctx);
-			getToken(ctx);
-			break;
-#endif
-		}
+		if (getenv("DM") && !(ctx->fpDm = openOutput(ctx, 4, "dm")))
+			return NO;
+	}
+
+	for (ii = 0; ii < argc; ii++)
+		printf("%s%c", argv[ii], (ii < argc-1) ? ' ' : '\n');
+
+	startContext(ctx);
+	return YES;
+}
+
+// Open and load the collation base, which gives the output files' base name.
+static int
+	openCollation(Context *ctx, char *base)
+{
+	// A collation of "-" is read from stdin, and written to stdin.{tx,no,vr}
+	if (strcmp(base, "-") == 0) {
+		ctx->fpMss = stdin;
+		base = "stdin";
+	} else
+		ctx->fpMss = fopen(base, "r");
+	if (!ctx->fpMss) {
+		fprintf(ctx->fpErr, "Cannot open collation file: %s\n", base);
+		return NO;
 	}
-	if (ctx->nParallels == 0) {
-		ctx->nParallels = 1;
-		ctx->par[0].name_space = EOS;
+	if (!loadMss(ctx)) {
+		fprintf(ctx->fpErr, "Cannot read collation file: %s\n", base);
+		return NO;
 	}
+	ctx->base = base;
+	return YES;
+}
+
+// The rest of what the parse starts from
+static void
+	startContext(Context *ctx)
+{
+	int ii;
+
+	ctx->Root = getenv("ROOT");
+	ctx->rootSet = (ctx->Root != (char *) 0);
+	// Turn off ROOT if nul string
+	if (ctx->Root && !ctx->Root[0])
+		ctx->Root = 0;
+
+	// Everything is counted as it is parsed, in a single pass.
+	ctx->nMSS = 0;
+	ctx->nVar = 0;
+	ctx->nPiece = 0;
+	ctx->nSets = 0;
+	ctx->nParallels = 0;
 	ctx->parallel = 0;
 
-	// Turn off ROOT if nul string
-	if (ctx->Root && !ctx->Root[0]) {
-		ctx->Root = 0;
-		ctx->nMSS--;
-	}
-
-	rewind(ctx->fpMss);
-	ctx->lineno = 0;
-	ctx->inc_line_p = YES;
-	for (ii = 0; ii < argc; ii++)
-		printf("%s%c", argv[ii], (ii < argc-1) ? ' ' : '\n');
-	printf("Parallels=%d; MSS=%d; VarUnits=%d; Pieces=%d; Sets=%d\n",
-		ctx->nParallels, ctx->nMSS, ctx->nVar, ctx->nPiece, ctx->nSets);
-	if (ctx->nMSS == 0) {
-		fprintf(stderr, "No witnesses, terminating...\n");
-		return NO;
-	}	
+	rewindMss(ctx);
+	for (ii = 0; ii < dimof(ctx->par); ii++)
+		strcpy(ctx->par[ii].position, "Beginning");
+	ctx->lemma[0] = EOS;
 
 	ctx->mss = (Witness *) 0;	// to be initialized in doMSS()
 
-	strcpy(ctx->par[ctx->parallel].position, "Beginning");
-
-	// Set up array of readings for each variation unit.
-	ctx->nRdgs = new(ctx->nVar, int);
-	assert( ctx->nRdgs );
-	ctx->wgts = new(ctx->nVar, int);
-	assert( ctx->wgts );
-	for (ii = 0; ii < ctx->nVar; ii++) {
-		ctx->nRdgs[ii] = 0;
-		ctx->wgts[ii] = 1;
-	}
+	// Per-unit arrays grow as the units are parsed.
+	ctx->maxVar = ctx->maxPiece = ctx->maxSets = 0;
+	ctx->nRdgs = ctx->wgts = ctx->pieceUnits = ctx->pieceVar = ctx->pieceSet = (int *) 0;
+	ctx->states = (char **) 0;
 
 	{
 		char *w = getenv("WEIGHBYED");
 		ctx->weighByED = (w) ? atoi(w) : WEIGHBYED;
+		w = getenv("AUTOED");
+		ctx->autoED = (w) ? atoi(w) : 0;
+		if (ctx->autoED < 0)
+			ctx->autoED = 0;
 	}
 	
-	// Set up states array
-	ctx->states = new(ctx->nSets, char *);
-	assert( ctx->states );
-	for (ii = 0; ii < ctx->nSets; ii++)
-		ctx->states[ii] = (char *) 0;
-
-	// Set up pieceUnits count
-	ctx->pieceUnits = new(ctx->nPiece, int);
-	assert( ctx->pieceUnits );
-	for (ii = 0; ii < ctx->nPiece; ii++)
-		ctx->pieceUnits[ii] = 0;
-
-	for (ii = 0; ii < ctx->nParallels; ii++) {
+	for (ii = 0; ii < dimof(ctx->par); ii++) {
 		int jj;
 
 		ctx->par[ii].pMacros = new(MAXMACRO, Macro *);
@@ -1075,8 +5424,222 @@ static int
 	ctx->piece = -1;
 
 	ctx->didChron = NO;		// Did not or have not done it yet.
+	ctx->nChron = 0;
+	ctx->chronFiles = (char **) 0;
+	ctx->nWarned = 0;
+
+	memset(&ctx->arena, 0, sizeof ctx->arena);
+	ctx->interned = (char **) 0;
+	ctx->internMask = 0;
+	ctx->nInterned = 0;
+
+	ctx->blocks = NO;
+	ctx->blk.open = NO;
+	ctx->blk.touched = ctx->blk.seen = ctx->blk.codes = ctx->blk.slots = (int *) 0;
+	ctx->blk.rows = (Hand **) 0;
+	ctx->blk.grid = (char **) 0;
+	ctx->blk.nTouched = ctx->blk.maxTouched = ctx->blk.maxSeen = 0;
+	ctx->blk.maxRows = ctx->blk.maxCodes = ctx->blk.maxSlots = ctx->blk.maxGrid = 0;
+	ctx->newBlocks = ctx->oldBlocks = (Block *) 0;
+	ctx->nNew = ctx->maxNew = ctx->nOld = 0;
+	ctx->oldIndex = (int *) 0;
+	ctx->oldBuf = (char *) 0;
+
+	ctx->chunks = (Chunk *) 0;
+	ctx->nChunks = ctx->maxChunks = ctx->atChunk = 0;
+	ctx->skimTo = 0;
+	ctx->lacunae = (Lacuna *) 0;
+	ctx->nLacunae = ctx->maxLacunae = ctx->atLacuna = 0;
+	ctx->workers = (Context **) 0;
+	ctx->nWorkers = ctx->waveEnd = 0;
+	ctx->errBuf = (char *) 0;
+	ctx->errLen = 0;
+
+	ctx->pools = (Pool *) 0;
+	ctx->poolSrcs = (int *) 0;
+	ctx->nPools = ctx->maxPools = ctx->nPoolSrcs = ctx->maxPoolSrcs = 0;
+}
 
-	return YES;
+// Grow an array of elements of size sz to hold at least need elements.
+static void *
+	growArray(void *a, int *max, int need, size_t sz)
+{
+	int nmax = (*max) ? *max : 64;
+
+	while (nmax < need)
+		nmax *= 2;
+	if (nmax == *max)
+		return a;
+	a = realloc(a, nmax * sz);
+	assert( a );
+	*max = nmax;
+	return a;
+}
+
+/*
+	Bump allocation from blocks of ARENABLOCK, for what lives as long as
+	its Context:  names, hands and reading states.  Big requests get a
+	block to themselves.  Pieces are aligned for any type.
+*/
+#define ARENABLOCK (64*1024)
+#define ARENAALIGN 8
+
+static void *
+	arenaAlloc(Arena *a, size_t n)
+{
+	char *p;
+
+	n = (n + ARENAALIGN-1) & ~(size_t) (ARENAALIGN-1);
+	if (n > (size_t) (a->end - a->p)) {
+		size_t size = (n > ARENABLOCK/4) ? n : ARENABLOCK;
+
+		a->blocks = growArray(a->blocks, &a->maxBlocks, a->nBlocks+1, sizeof (char *));
+		p = new(size, char);
+		assert( p );
+		a->blocks[a->nBlocks++] = p;
+		if (size == n)
+			return p;
+		a->p = p;
+		a->end = p + size;
+	}
+	p = a->p;
+	a->p += n;
+	return p;
+}
+
+static char *
+	arenaStr(Arena *a, const char *s)
+{
+	size_t len = strlen(s) + 1;
+
+	return memcpy(arenaAlloc(a, len), s, len);
+}
+
+// Take over the blocks of the arena from into a.
+static void
+	adoptArena(Arena *a, Arena *from)
+{
+	a->blocks = growArray(a->blocks, &a->maxBlocks, a->nBlocks + from->nBlocks, sizeof (char *));
+	memcpy(a->blocks + a->nBlocks, from->blocks, from->nBlocks * sizeof (char *));
+	a->nBlocks += from->nBlocks;
+	free(from->blocks);
+	memset(from, 0, sizeof *from);
+}
+
+static void
+	freeArena(Arena *a)
+{
+	int ii;
+
+	for (ii = 0; ii < a->nBlocks; ii++)
+		free(a->blocks[ii]);
+	free(a->blocks);
+	memset(a, 0, sizeof *a);
+}
+
+// The one copy of the len chars at s, kept in the arena.
+static char *
+	intern(Context *ctx, const char *s, size_t len)
+{
+	unsigned slot;
+	char *t;
+
+	if (2 * (ctx->nInterned + 1) > ctx->internMask) {
+		unsigned mask = (ctx->internMask) ? 2 * ctx->internMask + 1 : 1023;
+		char **tab = calloc(mask + 1, sizeof (char *));
+		unsigned ii;
+
+		assert( tab );
+		for (ii = 0; ctx->internMask && ii <= ctx->internMask; ii++) {
+			if (!(t = ctx->interned[ii]))
+				continue;
+			for (slot = hashBytes(t, strlen(t)) & mask; tab[slot]; slot = (slot + 1) & mask)
+				;
+			tab[slot] = t;
+		}
+		free(ctx->interned);
+		ctx->interned = tab;
+		ctx->internMask = mask;
+	}
+
+	ctx->counts.interns++;
+	for (slot = hashBytes(s, len) & ctx->internMask; (t = ctx->interned[slot]);
+			slot = (slot + 1) & ctx->internMask) {
+		// Lengths first, so as not to read past a shorter t
+		if (strnlen(t, len+1) == len && memcmp(t, s, len) == 0)
+			return t;
+	}
+	t = arenaAlloc(&ctx->arena, len + 1);
+	memcpy(t, s, len);
+	t[len] = EOS;
+	ctx->interned[slot] = t;
+	ctx->nInterned++;
+	return t;
+}
+
+// Make room for variation unit var
+static void
+	growVars(Context *ctx, int var)
+{
+	int old = ctx->maxVar, max = ctx->maxVar, ii;
+
+	if (var < ctx->maxVar)
+		return;
+	ctx->nRdgs = growArray(ctx->nRdgs, &max, var+1, sizeof (int));
+	ctx->wgts = growArray(ctx->wgts, &ctx->maxVar, var+1, sizeof (int));
+	for (ii = old; ii < ctx->maxVar; ii++) {
+		ctx->nRdgs[ii] = 0;
+		ctx->wgts[ii] = 1;
+	}
+}
+
+// Make room for set
+static void
+	growSets(Context *ctx, int set)
+{
+	int old = ctx->maxSets, ii;
+
+	if (set < ctx->maxSets)
+		return;
+	ctx->states = growArray(ctx->states, &ctx->maxSets, set+1, sizeof (char *));
+	for (ii = old; ii < ctx->maxSets; ii++)
+		ctx->states[ii] = (char *) 0;
+}
+
+// Make room for piece, both in pieceUnits and in every hand 0.
+static void
+	growPieces(Context *ctx, int piece)
+{
+	int old = ctx->maxPiece, max = ctx->maxPiece, ii;
+	int pp, ms;
+
+	if (piece < ctx->maxPiece)
+		return;
+	ctx->pieceVar = growArray(ctx->pieceVar, &max, piece+1, sizeof (int));
+	max = old;
+	ctx->pieceSet = growArray(ctx->pieceSet, &max, piece+1, sizeof (int));
+	ctx->pieceUnits = growArray(ctx->pieceUnits, &ctx->maxPiece, piece+1, sizeof (int));
+	for (ii = old; ii < ctx->maxPiece; ii++)
+		ctx->pieceUnits[ii] = ctx->pieceVar[ii] = ctx->pieceSet[ii] = 0;
+
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Hand *h = &ctx->par[pp].msHands[ms][0];
+		h->sets = realloc(h->sets, ctx->maxPiece * sizeof (char *));
+		assert( h->sets );
+		for (ii = old; ii < ctx->maxPiece; ii++)
+			h->sets[ii] = (char *) 0;
+	}
+}
+
+// Commands that refer to witnesses must come after the * list.
+static int
+	needMSS(Context *ctx, char *cmd)
+{
+	if (ctx->nMSS > 0)
+		return YES;
+	fWarn(ctx, cmd, "Witnesses must be declared (with *) first.", "");
+	return NO;
 }
 
 static void
@@ -1085,19 +5648,18 @@ static void
 	char *s;
 
 	assert( w );
-	w->name = strdup(name);
+	w->name = arenaStr(&ctx->arena, name);
 	w->Aland = w->name;
 	w->pname = w->name;
-	assert( w->name );
 
 	// Inline aliasing
 	if ((s = strchr(w->name, CVT))) {
 		*s++ = EOS;
-		w->Aland = strdup(s);
+		w->Aland = s;
 
 		if ((s = strchr(w->Aland, CVT))) {
 			*s++ = EOS;
-			w->pname = strdup(s);
+			w->pname = s;
 		}
 	}
 	w->corrected = NO;
@@ -1109,50 +5671,48 @@ static void
 	int ms, hh;
 	Macro *all; 		// The $* macro, holds all the taxa
 	Macro *miss;		// The $? macro, holds the missing taxa
+	Hand *block;		// The hands of all the witnesses
 
 	// One-char name
 	p->name_space = name;
 
 	// Set up macro for all.
-	all = new(1, Macro);
-	assert( all );
-
-	all->level = ctx->macLevel++;
-	all->inset = new(ctx->nMSS, int);
-	assert( all->inset );
+	all = newMacro(ctx);
+	for (ms = 0; ms < ctx->nMSS; ms++)
+		BITSET(all->inset, ms);
 	p->pMacros['*'] = all;
 
 	// Set up macro for missings.
-	miss = new(1, Macro);
-	assert( miss );
-
-	miss->level = ctx->macLevel++;
-	miss->inset = new(ctx->nMSS, int);
-	assert( miss->inset );
+	miss = newMacro(ctx);
 	p->pMacros['?'] = miss;
 
-	p->msHands = new(ctx->nMSS, Hand *);
-	assert( p->msHands );
+	p->msHands = arenaAlloc(&ctx->arena, ctx->nMSS * sizeof (Hand *));
+	block = arenaAlloc(&ctx->arena, ctx->nMSS * MAXHAND * sizeof (Hand));
 
 	for (ms = 0; ms < ctx->nMSS; ms++) {
-		all->inset[ms] = YES;
-		miss->inset[ms] = NO;
-
-		p->msHands[ms] = new(MAXHAND, Hand);
-		assert( p->msHands[ms] );
+		p->msHands[ms] = &block[ms * MAXHAND];
 		for (hh = 0; hh < MAXHAND; hh++) {
 			Hand *hands = p->msHands[ms];
 			int ii;
 
-			hands[hh].sets = new(ctx->nPiece, char *);
-			assert( hands[hh].sets );
-			for (ii = 0; ii < ctx->nPiece; ii++)
-				hands[hh].sets[ii] = (char *) 0;
+			// Correctors' readings are kept by pcs, as they come
+			hands[hh].sets = (char **) 0;
+			if (hh == 0) {
+				hands[hh].sets = new(ctx->maxPiece, char *);
+				assert( hands[hh].sets || ctx->maxPiece == 0 );
+				for (ii = 0; ii < ctx->maxPiece; ii++)
+					hands[hh].sets[ii] = (char *) 0;
+			}
 			hands[hh].earliest = hands[hh].average = 0;
 			hands[hh].latest = INT_MAX;
 			hands[hh].suppressed = (ctx->Root && ms == 0) ? YES : NO;		// Possibly redundant with code in doMSS()
 			hands[hh].mandated = NO;
 			hands[hh].inLacuna = NO;
+			hands[hh].lastHand = 0;
+			hands[hh].nExtant = 0;
+			hands[hh].pcs = (int *) 0;
+			hands[hh].pcSets = (char **) 0;
+			hands[hh].nPcs = hands[hh].maxPcs = 0;
 		}
 	}
 }
@@ -1161,29 +5721,38 @@ static void
 static Status
 	doMSS(Context *ctx)
 {
-	int ms, pp;
-	char *token;
+	int ms, pp, maxMSS = 0;
+	char *token = ctx->token;
 
 	if (ctx->mss) {
 		fWarn(ctx, "*", "Already declared the witnesses.", "");
 		return FATAL;
 	}
 	ctx->token_lineno = ctx->lineno;
-	ctx->mss = new(ctx->nMSS, Witness);
-	assert( ctx->mss );
-	
-	pp = ms = 0;
-	if (ctx->Root)
+
+	// Allow ROOT= to be specified with *ROOT, unless ROOT is set (even to none)
+	if (!ctx->rootSet && token[1])
+		ctx->Root = arenaStr(&ctx->arena, token+1);
+
+	ms = 0;
+	if (ctx->Root) {
+		ctx->mss = growArray(ctx->mss, &maxMSS, ms+1, sizeof (Witness));
 		initWitness(ctx, &ctx->mss[ms++], ctx->Root);
-		
+	}
+
 	while ((token = getToken(ctx))) {
 		switch (*token) {
 		default:
+			ctx->mss = growArray(ctx->mss, &maxMSS, ms+1, sizeof (Witness));
 			initWitness(ctx, &ctx->mss[ms++], token);
 			break;
 
 		case '/':
-			initParallel(ctx, &ctx->par[pp++], token[1]);
+			if (ctx->nParallels == dimof(ctx->par)) {
+				fWarn(ctx, "*", "Too many parallels:", token);
+				return FATAL;
+			}
+			ctx->par[ctx->nParallels++].name_space = token[1];
 			break;
 
 		case '"':
@@ -1191,10 +5760,20 @@ static Status
 			break;
 
 		case ';':
-			// Global Macro
-			assert( ms == ctx->nMSS );
-			if (pp == 0)
-				initParallel(ctx, &ctx->par[0], EOS);
+			// Witness storage is final, so set up the hands for each parallel.
+			ctx->nMSS = ms;
+			if (ctx->nMSS == 0) {
+				fWarn(ctx, "*", "No witnesses declared.", "");
+				return FATAL;
+			}
+			if (ctx->nParallels == 0) {
+				ctx->nParallels = 1;
+				ctx->par[0].name_space = EOS;
+			}
+			ctx->macWords = BITWORDS(ctx->nMSS);
+			for (pp = 0; pp < ctx->nParallels; pp++)
+				initParallel(ctx, &ctx->par[pp], ctx->par[pp].name_space);
+			indexMSS(ctx);
 
 			// Unsuppress ROOT in the earliest parallel
 			if (ctx->Root) {
@@ -1208,7 +5787,6 @@ static Status
 		}
 	}
 	EOFWARN(ctx, "*");
-	assert( token );
 	return FATAL;
 }
 
@@ -1236,10 +5814,13 @@ static Status
 	char *token = ctx->token;
 	Macro *macro, *mac2;
 	int name;
-	int ms, hh;
+	int ms, hh, ww;
 	enum { SET, ADD, SUB, CHK, } act;
 	int nWarn = 0;
 
+	if (!needMSS(ctx, "="))
+		return FATAL;
+
 	switch (token[1]) {
 	case EOS: act = SET; break;
 	case '+': act = ADD; break;
@@ -1265,18 +5846,10 @@ static Status
 	ctx->token_lineno = ctx->lineno;
 	macro = ctx->par[ctx->parallel].pMacros[name];
 	if (!macro) {
-		macro = new(1, Macro);
-		assert( macro );
-		macro->level = ctx->macLevel++;
-		macro->inset = new(ctx->nMSS, int);
-		assert( macro->inset );
+		macro = newMacro(ctx);
 		ctx->par[ctx->parallel].pMacros[name] = macro;
-		for (ms = 0; ms < ctx->nMSS; ms++)
-			macro->inset[ms] = NO;
-	} else if (act == SET) {
-		for (ms = 0; ms < ctx->nMSS; ms++)
-			macro->inset[ms] = NO;
-	}
+	} else if (act == SET)
+		memset(macro->inset, 0, ctx->macWords * sizeof (uint64_t));
 
 	while ((token = getToken(ctx))) {
 		switch (*token) {
@@ -1299,7 +5872,7 @@ static Status
 
 			switch (act) {
 			case CHK:
-				if (!macro->inset[ms]) {
+				if (!BITTEST(macro->inset, ms)) {
 					char buf[MAXTOKEN*2];
 					sprintf(buf, "Check failed for macro $%c:", name);
 					fWarn(ctx, "=", buf, token);
@@ -1307,10 +5880,10 @@ static Status
 				}
 				break;
 			case SUB:
-				macro->inset[ms] = NO;
+				BITCLR(macro->inset, ms);
 				break;
 			case ADD: case SET: default:
-				macro->inset[ms] = YES;
+				BITSET(macro->inset, ms);
 				break;
 			}
 			break;
@@ -1321,26 +5894,27 @@ static Status
 				nWarn++;
 				continue;
 			}
-			for (ms = 0; ms < ctx->nMSS; ms++) {
-				if (!mac2->inset[ms])
-					continue;
-
-				switch (act) {
-				case CHK:
-					if (!macro->inset[ms]) {
+			switch (act) {
+			case CHK:
+				// Warn for each member of mac2 missing from macro
+				for (ww = 0; ww < ctx->macWords; ww++) {
+					uint64_t missing = mac2->inset[ww] & ~macro->inset[ww];
+					for ( ; missing; missing &= missing - 1) {
 						char buf[MAXTOKEN*2];
 						sprintf(buf, "Check failed for macro $%c:", name);
 						fWarn(ctx, "=", buf, token);
 						nWarn++;
 					}
-					break;
-				case SUB:
-					macro->inset[ms] = NO;
-					break;
-				case ADD: case SET: default:
-					macro->inset[ms] = YES;
-					break;
 				}
+				break;
+			case SUB:
+				for (ww = 0; ww < ctx->macWords; ww++)
+					macro->inset[ww] &= ~mac2->inset[ww];
+				break;
+			case ADD: case SET: default:
+				for (ww = 0; ww < ctx->macWords; ww++)
+					macro->inset[ww] |= mac2->inset[ww];
+				break;
 			}
 			break;
 		case ';':
@@ -1364,6 +5938,9 @@ static Status
 	enum { ADD, SUB, CHK } act;
 	Macro *macro;
 
+	if (!needMSS(ctx, "%"))
+		return FATAL;
+
 	switch (token[1]) {
 	case '+': act = ADD; break;
 	case '-': act = SUB; break;
@@ -1393,6 +5970,7 @@ static Status
 				continue;
 			}
 			h = &ctx->par[ctx->parallel].msHands[ms][hh];
+			noteHand(ctx, ms, YES);
 			switch (act) {
 			case ADD:
 				if (h->inLacuna == NO) {
@@ -1429,10 +6007,10 @@ static Status
 				nWarn++;
 				continue;
 			}
-			for (ms = (ctx->Root) ? 1 : 0; ms < ctx->nMSS; ms++) {
-				if (!macro->inset[ms])
-					continue;
+			for (ms = nextBit(macro->inset, ctx->macWords, (ctx->Root) ? 1 : 0);
+					ms >= 0; ms = nextBit(macro->inset, ctx->macWords, ms+1)) {
 				h = &ctx->par[ctx->parallel].msHands[ms][0];
+				noteHand(ctx, ms, YES);
 				switch (act) {
 				case ADD:
 					if (h->inLacuna == NO) {
@@ -1476,6 +6054,7 @@ static Status
 {
 	char *token;
 
+	noteVr(ctx);
 	ctx->token_lineno = ctx->lineno;
 	token = getToken(ctx);
 	if (!token) {
@@ -1483,9 +6062,129 @@ static Status
 		return FATAL;
 	}
 	strcpy(ctx->par[ctx->parallel].position, token);
+	ctx->nEdLem = 0;
 	return OK;
 }
 
+/*
+	AUTOED:  a plain unit (without |n or |*n) is weighed by the word
+	edit-distance of its readings from the lemma words they replace, the
+	most of any of them, binned by AUTOED as |n is by WEIGHBYED.  A
+	reading is a token, less any n= before it, its words joined by _;
+	"om" has none.  As lemma/variant (set/put) it replaces its own lemma
+	words, and the distance is between the two.  Otherwise it replaces
+	the span of the [ ] lemma nearest it, however long the lemma is, and
+	an omission so counts one word.  A [ ] with no lemma (or only a
+	"comment") takes the last lemma of its @ block, so the readings may
+	follow their lemma in a [ ] of their own; with none, a reading counts
+	its own words.  The distance is Myers' bit-vector one (as Hyyro has
+	it), the first MAXEDWORDS words of the reading a bit each, and words
+	compared by their hashes.
+*/
+
+// Hash the words of [s, end), split at _, into w; "om" has none.
+static int
+	edWords(const char *s, const char *end, uint64_t *w)
+{
+	const char *q;
+	int n = 0;
+
+	if (end - s == 2 && memcmp(s, "om", 2) == 0)
+		return 0;
+	for ( ; s < end && n < MAXEDWORDS; s = q+1) {
+		for (q = s; q < end && *q != '_'; q++)
+			;
+		w[n++] = hashBytes(s, q - s);
+	}
+	return n;
+}
+
+// Distance of the m (at most 64) words of p from all of the n of t,
+// or (span) from the span of t nearest them.
+static int
+	edMyers(const uint64_t *p, int m, const uint64_t *t, int n, int span)
+{
+	uint64_t pv = ~(uint64_t) 0, mv = 0, high;
+	int score = m, best = m, ii, jj;
+
+	if (m == 0)
+		return (span) ? 0 : n;
+	high = (uint64_t) 1 << (m-1);
+	for (jj = 0; jj < n; jj++) {
+		uint64_t eq = 0, xv, xh, ph, mh;
+
+		for (ii = 0; ii < m; ii++)
+			eq |= (uint64_t) (p[ii] == t[jj]) << ii;
+		xv = eq | mv;
+		xh = (((eq & pv) + pv) ^ pv) | eq;
+		ph = mv | ~(xh | pv);
+		mh = pv & xh;
+		if (ph & high)
+			score++;
+		else if (mh & high)
+			score--;
+		ph <<= 1;
+		mh <<= 1;
+		if (!span)
+			ph |= 1;		// The top row counts the words of t
+		pv = mh | ~(xv | ph);
+		mv = ph & xv;
+		if (score < best)
+			best = score;
+	}
+	return (span) ? best : score;
+}
+
+static int
+	edDistance(const uint64_t *lem, int m, const char *rdg)
+{
+	uint64_t from[MAXEDWORDS], to[MAXEDWORDS];
+	const char *p = rdg, *slash, *end;
+	int nFrom, nTo;
+
+	while (isdigit((unsigned char) *p))
+		p++;
+	if (*p == '=')
+		rdg = p+1;
+	end = rdg + strlen(rdg);
+
+	if ((slash = strchr(rdg, '/'))) {
+		nFrom = edWords(rdg, slash, from);
+		nTo = edWords(slash+1, end, to);
+		return edMyers(from, nFrom, to, nTo, NO);
+	}
+	nTo = edWords(rdg, end, to);
+	if (nTo == 0)
+		return (m > 0) ? 1 : 0;
+	return edMyers(to, nTo, lem, m, YES);
+}
+
+// Keep the lemma of this [ ] for those after it, or take theirs if it has none.
+static void
+	edLemma(Context *ctx, uint64_t *words, int *n)
+{
+	if (*n > 0) {
+		memcpy(ctx->edLem, words, *n * sizeof *words);
+		ctx->nEdLem = *n;
+	} else {
+		memcpy(words, ctx->edLem, ctx->nEdLem * sizeof *words);
+		*n = ctx->nEdLem;
+	}
+}
+
+// Weigh unit var (if plain) by dist, under AUTOED.
+static void
+	edWeigh(Context *ctx, int var, int dist)
+{
+	int wgt;
+
+	if (var < 0)
+		return;
+	wgt = (dist > 0) ? (dist-1)/ctx->autoED + 1 : 1;
+	ctx->wvar += wgt - ctx->wgts[var];
+	ctx->wgts[var] = wgt;
+}
+
 // Syntax:	[ {lemma}* { | {*{n}} {var-state}+ }+ ]
 static Status
 	doReadings(Context *ctx)
@@ -1493,14 +6192,22 @@ static Status
 	char *token;
 	char *lem, *end;
 	int lemma = YES, space = NO, var = -1;
+	uint64_t lemWords[MAXEDWORDS];
+	int nLemWords = 0, comment = NO, edVar = -1, edMax = 0;
+
+	assert( dimof(lemWords) == dimof(ctx->edLem) );
 
 	lem = ctx->lemma;
 	end = &ctx->lemma[dimof(ctx->lemma)];
 	*lem = EOS;
 
+	noteVr(ctx);
 	ctx->token_lineno = ctx->lineno;
 	ctx->piece++;
+	growPieces(ctx, ctx->piece);
 	ctx->pieceUnits[ctx->piece] = 0;
+	ctx->pieceVar[ctx->piece] = ctx->var;
+	ctx->pieceSet[ctx->piece] = ctx->set;
 	while ((token = getToken(ctx))) {
 		switch (*token) {
 		default:
@@ -1514,10 +6221,29 @@ static Status
 				ctx->nRdgs[var]++;
 			}
 			space = YES;
+			if (!ctx->autoED)
+				break;
+			if (*token == '"') {
+				if (token[1] == EOS || token[strlen(token)-1] != '"')
+					comment = !comment;		// (Not a whole "comment")
+			} else if (comment)
+				;
+			else if (lemma && nLemWords < MAXEDWORDS)
+				lemWords[nLemWords++] = hashBytes(token, strlen(token));
+			else if (!lemma && edVar >= 0) {
+				int dist = edDistance(lemWords, nLemWords, token);
+				if (dist > edMax)
+					edMax = dist;
+			}
 			break;
 		case '|':
+			if (ctx->autoED && lemma)
+				edLemma(ctx, lemWords, &nLemWords);
+			if (ctx->autoED)
+				edWeigh(ctx, edVar, edMax);
 			var = ctx->var++;
-			assert( ctx->wgts[var] == 1 );	// Should've been init'd in initContext()
+			growVars(ctx, var);
+			assert( ctx->wgts[var] == 1 );	// Should've been init'd in growVars()
 			if (token[1] == EOS)
 				;
 			else if (token[1] == '*')
@@ -1537,8 +6263,14 @@ static Status
 			ctx->pieceUnits[ctx->piece]++;
 			lemma = NO;
 			space = NO;
+			edVar = (token[1] == EOS) ? var : -1;
+			edMax = 0;
 			break;
 		case ']':
+			if (ctx->autoED && lemma)
+				edLemma(ctx, lemWords, &nLemWords);
+			if (ctx->autoED)
+				edWeigh(ctx, edVar, edMax);
 			return OK;
 		}
 	}
@@ -1546,6 +6278,40 @@ static Status
 	return FATAL;
 }
 
+// Weighted units with a reading (not MISSING) in rdgs, for the current piece.
+static int
+	extant(Context *ctx, char *rdgs)
+{
+	int var = ctx->pieceVar[ctx->piece], n = 0;
+
+	for ( ; rdgs && *rdgs; rdgs++, var++) {
+		if (*rdgs != MISSING)
+			n += ctx->wgts[var];
+	}
+	return n;
+}
+
+/*
+	Give hand hh of witness ms (in the current parallel) its readings for
+	the current piece, keeping the counts suppressTx() needs up to date:
+	nExtant for the original hand, and the list of pieces a corrector
+	has readings of its own for.
+*/
+static void
+	assignSet(Context *ctx, int ms, int hh, char *rdgs)
+{
+	Hand *h = &ctx->par[ctx->parallel].msHands[ms][hh];
+
+	if (ctx->blk.open && !ctx->blk.dirty)
+		noteAssign(ctx, ms, hh, rdgs);
+
+	if (hh == 0) {
+		h->nExtant += extant(ctx, rdgs) - extant(ctx, h->sets[ctx->piece]);
+		h->sets[ctx->piece] = rdgs;
+	} else
+		correctorSet(h, ctx->piece, rdgs);
+}
+
 // Syntax:	< {states} {mss-names}+ { | {states} {mss-names}+ }+ >
 static Status
 	doWitnesses(Context *ctx)
@@ -1556,7 +6322,8 @@ static Status
 	int nWarn = 0;
 	Parallel *para = &ctx->par[ctx->parallel];
 
-	assert( ctx->mss );
+	if (!needMSS(ctx, "<"))
+		return FATAL;
 	ctx->token_lineno = ctx->lineno;
 	for (ms = 0; ms < ctx->nMSS; ms++) {
 		register Hand *hands = para->msHands[ms];
@@ -1578,10 +6345,10 @@ static Status
 
 				// Save off states for this set
 				set = ctx->set++;
+				growSets(ctx, set);
 				assert( ctx->states[set] == (char *) 0 );
 
-				rdgs = strdup(token);
-				assert( rdgs );
+				rdgs = intern(ctx, token, strlen(token));
 
 				// Check if digit readings are in range:
 				s = rdgs;
@@ -1613,14 +6380,14 @@ static Status
 					continue;
 				//w = &ctx->mss[ms];
 				hands = para->msHands[ms];
-				if (hands[hh].sets[ctx->piece]
+				if (handSet(hands, hh, ctx->piece)
 				&& hands[0].level == MAXMACRO) {
 					fWarn(ctx, "<", "Duplicate:", token);
 					nWarn++;
 					continue;
 				}
 				assert( rdgs );
-				hands[hh].sets[ctx->piece] = rdgs;
+				assignSet(ctx, ms, hh, rdgs);
 				hands[hh].level = MAXMACRO;
 			}
 			break;
@@ -1631,10 +6398,9 @@ static Status
 				nWarn++;
 				continue;
 			}
-			for (ms = 0; ms < ctx->nMSS; ms++) {
+			for (ms = nextBit(macro->inset, ctx->macWords, 0);
+					ms >= 0; ms = nextBit(macro->inset, ctx->macWords, ms+1)) {
 				register Hand *hands = para->msHands[ms];
-				if (!macro->inset[ms])
-					continue;
 				if (hands[0].inLacuna)
 					continue;
 				if (hands[0].level > macro->level)
@@ -1644,7 +6410,7 @@ static Status
 					nWarn++;
 					continue;
 				}
-				hands[0].sets[ctx->piece] = rdgs;
+				assignSet(ctx, ms, 0, rdgs);
 				hands[0].level = macro->level;
 			}
 			break;
@@ -1671,15 +6437,15 @@ static Status
 				}
 
 				// Let implicit $? override macros
-				if (para->pMacros['?']->inset[ms]
+				if (BITTEST(para->pMacros['?']->inset, ms)
 				&& hands[0].level <= para->pMacros['?']->level) {
-					hands[0].sets[ctx->piece] = 0;
+					assignSet(ctx, ms, 0, (char *) 0);
 					continue;
 				}
 
 				// Warn if unassigned taxa are not in $?
 				if (!hands[0].sets[ctx->piece]
-				&& !para->pMacros['?']->inset[ms]) {
+				&& !BITTEST(para->pMacros['?']->inset, ms)) {
 					fWarn(ctx, ">", "Unassigned:",
 						parName(ctx, ctx->parallel, w->corrected, 0, w->name));
 					nWarn++;
@@ -1701,9 +6467,11 @@ static Status
 	doChron(Context *ctx)
 {
 	char *token, *fn;
-	FILE *fpChron;
-	char witness[80];
-	int minD, midD, maxD;
+	Chron *chron;
+	int dd;
+
+	if (!needMSS(ctx, "^"))
+		return FATAL;
 
 	ctx->token_lineno = ctx->lineno;
 	token = getToken(ctx);
@@ -1718,98 +6486,191 @@ static Status
 		snprintf(buf, dimof(buf), "%s%s", getenv("HOME"), &fn[1]);
 		fn = buf;
 	}
-	fpChron = fopen(fn, "r");
-	if (!fpChron) {
+	ctx->chronFiles = realloc(ctx->chronFiles, (ctx->nChron+1) * sizeof (char *));
+	assert( ctx->chronFiles );
+	ctx->chronFiles[ctx->nChron] = strdup(fn);
+	assert( ctx->chronFiles[ctx->nChron] );
+	ctx->nChron++;
+
+	pthread_mutex_lock(&ChronLock);
+	if (!(chron = loadChron(ctx, fn))) {
+		pthread_mutex_unlock(&ChronLock);
 		fWarn(ctx, "^", "Cannot open file:", token);
 		return FATAL;
 	}
-	
-	while (fscanf(fpChron, "%s %d %d %d", witness, &minD, &midD, &maxD) == 4) {
-		int hh = 0;
-		int ms = 0;
+	for (dd = 0; dd < chron->nDates; dd++) {
+		ChronDate *d = &chron->dates[dd];
+		int hh = d->hand, ms, unused;
 
-		while ((ms = findAland(ctx, witness, &hh, ms)) < ctx->nMSS) {
+		if (hh < 0 || hh >= MAXHAND)
+			continue;
+		for (ms = findAland(ctx, d->name, &unused); ms != NOMSS; ms = ctx->alandNext[ms]) {
 			int pp;
 			for (pp = 0; pp < ctx->nParallels; pp++) {
 				register Hand *hands = ctx->par[pp].msHands[ms];
 				int h2;
 
-				hands[hh].earliest = minD;
-				hands[hh].average  = midD;
-				hands[hh].latest   = maxD;
+				hands[hh].earliest = d->minD;
+				hands[hh].average  = d->midD;
+				hands[hh].latest   = d->maxD;
 
 				if (hh != 0)
 					continue;
 				for (h2 = 1; h2 < MAXHAND; h2++) {
-					hands[h2].earliest = minD;
-					hands[h2].average  = midD;
+					hands[h2].earliest = d->minD;
+					hands[h2].average  = d->midD;
 					hands[h2].latest   = INT_MAX;
 				}
 			}
-			ms++;
 		}
 	}
-	
+	pthread_mutex_unlock(&ChronLock);
+
 	ctx->didChron = YES;
-	fclose(fpChron);
 	return OK;
 }
 
-// Syntax:	- {input-name}+ ;
+// Syntax:	- {input-name}+ ;
+static Status
+	doSuppress(Context *ctx)
+{
+	char *token;
+	int ms, hh;
+	register Hand *hands;
+	Macro *macro;
+	Parallel *para = &ctx->par[ctx->parallel];
+	Status status = OK;
+
+	if (!needMSS(ctx, "-"))
+		return FATAL;
+
+	ctx->token_lineno = ctx->lineno;
+	ms = 0;
+	while ((token = getToken(ctx))) {
+		switch (*token) {
+		default:
+			ms = findMSS(ctx, token, &hh);
+			if (ms == SUPPRESSED) {
+				fWarn(ctx, "-", "Already suppressed:", token);
+				status = WARN;
+				continue;
+			}
+			if (ms == NOMSS || ms == BADHAND) {
+				fWarn(ctx, "-", "Unknown:", token);
+				status = WARN;
+				continue;
+			}
+			hands = para->msHands[ms];
+			if (strchr(token, ':'))
+				hands[hh].suppressed = YES;
+			else {
+				for (hh = 0; hh < MAXHAND; hh++)
+					hands[hh].suppressed = YES;
+			}
+			break;
+		case '$':
+			macro = getMacro(ctx, token);
+			if (!macro) {
+				fWarn(ctx, "-", "Unknown macro:", token);
+				status = WARN;
+				continue;
+			}
+			for (ms = nextBit(macro->inset, ctx->macWords, (ctx->Root) ? 1 : 0);
+					ms >= 0; ms = nextBit(macro->inset, ctx->macWords, ms+1)) {
+				register Hand *hands = para->msHands[ms];
+				for (hh = 0; hh < MAXHAND; hh++)
+					hands[hh].suppressed = YES;
+			}
+			break;
+		case ';':
+			return status;
+		}
+	}
+	EOFWARN(ctx, "-");
+	assert( token );
+	return FATAL;
+}
+
+// Add hand hh of witness ms (-1 for the whole witness) to the last pool.
+static void
+	poolSrc(Context *ctx, int ms, int hh)
+{
+	ctx->poolSrcs = growArray(ctx->poolSrcs, &ctx->maxPoolSrcs, ctx->nPoolSrcs+2, sizeof (int));
+	ctx->poolSrcs[ctx->nPoolSrcs++] = ms;
+	ctx->poolSrcs[ctx->nPoolSrcs++] = hh;
+	ctx->pools[ctx->nPools-1].nSrcs++;
+}
+
+/*
+	Syntax:	& {pooled-name} {input-name}+ ;
+
+	Pool the inputs into the (declared) witness, in the current parallel;
+	it is done after the parse, by poolMss().  The pooled witness is in
+	lacuna from here, as its readings are to come from the pool.
+*/
 static Status
-	doSuppress(Context *ctx)
+	doPool(Context *ctx)
 {
 	char *token;
-	int ms, hh;
-	register Hand *hands;
+	int ms, hh, first = YES;
+	Pool *pool = (Pool *) 0;
 	Macro *macro;
-	Parallel *para = &ctx->par[ctx->parallel];
 	Status status = OK;
 
+	if (!needMSS(ctx, "&"))
+		return FATAL;
+
 	ctx->token_lineno = ctx->lineno;
-	ms = 0;
 	while ((token = getToken(ctx))) {
 		switch (*token) {
 		default:
 			ms = findMSS(ctx, token, &hh);
-			if (ms == SUPPRESSED) {
-				fWarn(ctx, "-", "Already suppressed:", token);
+			if (ms == NOMSS || ms == BADHAND || ms == SUPPRESSED) {
+				fWarn(ctx, "&", "Unknown:", token);
 				status = WARN;
-				continue;
-			}
-			if (ms == NOMSS || ms == BADHAND) {
-				fWarn(ctx, "-", "Unknown:", token);
+			} else if (first && strchr(token, ':')) {
+				fWarn(ctx, "&", "Pool into a witness, not a hand:", token);
 				status = WARN;
-				continue;
-			}
-			hands = para->msHands[ms];
-			if (strchr(token, ':'))
-				hands[hh].suppressed = YES;
-			else {
-				for (hh = 0; hh < MAXHAND; hh++)
-					hands[hh].suppressed = YES;
-			}
+			} else if (first) {
+				ctx->pools = growArray(ctx->pools, &ctx->maxPools, ctx->nPools+1, sizeof (Pool));
+				pool = &ctx->pools[ctx->nPools++];
+				pool->parallel = ctx->parallel;
+				pool->ms = ms;
+				pool->from = ctx->nPoolSrcs / 2;
+				pool->nSrcs = 0;
+				ctx->par[ctx->parallel].msHands[ms][0].inLacuna = YES;
+			} else if (pool && ms == pool->ms) {
+				fWarn(ctx, "&", "Pooled into itself:", token);
+				status = WARN;
+			} else if (pool)
+				poolSrc(ctx, ms, (strchr(token, ':')) ? hh : -1);
+			first = NO;
 			break;
 		case '$':
 			macro = getMacro(ctx, token);
-			if (!macro) {
-				fWarn(ctx, "-", "Unknown macro:", token);
+			if (!macro || first) {
+				fWarn(ctx, "&", (macro) ? "Pool into a witness, not a macro:" : "Unknown macro:", token);
 				status = WARN;
+				first = NO;
 				continue;
 			}
-			for (ms = (ctx->Root) ? 1 : 0; ms < ctx->nMSS; ms++) {
-				register Hand *hands = para->msHands[ms];
-				if (!macro->inset[ms])
-					continue;
-				for (hh = 0; hh < MAXHAND; hh++)
-					hands[hh].suppressed = YES;
+			if (!pool)
+				continue;
+			for (ms = nextBit(macro->inset, ctx->macWords, (ctx->Root) ? 1 : 0);
+					ms >= 0; ms = nextBit(macro->inset, ctx->macWords, ms+1)) {
+				if (ms != pool->ms)
+					poolSrc(ctx, ms, -1);
 			}
 			break;
 		case ';':
+			if (status == OK && (!pool || pool->nSrcs == 0)) {
+				fWarn(ctx, "&", "Nothing to pool", "");
+				status = WARN;
+			}
 			return status;
 		}
 	}
-	EOFWARN(ctx, "-");
+	EOFWARN(ctx, "&");
 	assert( token );
 	return FATAL;
 }
@@ -1837,6 +6698,9 @@ static Status
 	int ms, hh;
 	register Witness *w;
 
+	if (!needMSS(ctx, "~"))
+		return FATAL;
+
 	ctx->token_lineno = ctx->lineno;
 	token = getToken(ctx);
 	if (!token) {
@@ -1865,9 +6729,8 @@ static Status
 	}
 
 	if (strcmp(token, "=") != 0) {
-		if (w->Aland != w->name)
-			free(w->Aland);
-		w->Aland = strdup(token);
+		w->Aland = arenaStr(&ctx->arena, token);
+		ctx->alandStale = YES;
 	}
 
 	token = getToken(ctx);
@@ -1876,9 +6739,7 @@ static Status
 		return FATAL;
 	}
 
-	if (w->pname != w->name)
-		free(w->pname);
-	w->pname = strdup(token);
+	w->pname = arenaStr(&ctx->arena, token);
 
 	return OK;
 }
@@ -1900,10 +6761,19 @@ static Status
 
 /* ------------------------------------------------------ 
 ||
-||  Write Variant Readings file
+||  Write Variant Readings file:  the parse notes where each @ and [
+||  command is in mssBuf, so only those are read again for the .vr.
 ||
 */
 
+// The command just read is an @ or [, which the .vr will show.
+static void
+	noteVr(Context *ctx)
+{
+	ctx->vrAt = growArray(ctx->vrAt, &ctx->maxVr, ctx->nVr+1, sizeof (size_t));
+	ctx->vrAt[ctx->nVr++] = ctx->tokp - ctx->mssBuf;
+}
+
 // Syntax: @ {verse}
 static Status
 	vrVerse(Context *ctx)
@@ -1939,7 +6809,7 @@ static Status
 			wvar = (ctx->wvar += ctx->wgts[var]);
 			rdg = 0;
 			if (ctx->wgts[var] > 0)
-				fprintf(ctx->fpVr, "\n%4d  ", wvar-1);
+				fprintf(ctx->fpVr, "\n%4d  ", (ctx->txCol) ? ctx->txCol[var] : wvar-1);
 			else
 				fprintf(ctx->fpVr, "\n----  ");
 			lemma = NO;
@@ -1960,39 +6830,86 @@ static Status
 	return FATAL;
 }
 
+// Entries [lo, hi) of vrAt, by the job's copy of ctx (or ctx itself)
 static void
-	writeVr(Context *ctx)
+	vrShare(Share *s)
 {
+	Context *ctx = ((Context **) s->arg)[s->job];
 	char *token;
+	int ii;
 
-	rewind(ctx->fpMss);
-	ctx->var = 0;
-	ctx->wvar = 0;
-	while ((token = getToken(ctx)) && *token != '!') {
-		switch (*token) {
-		default:
+	for (ii = s->lo; ii < s->hi; ii++) {
+		ctx->mssPos = ctx->vrAt[ii];
+		if (!(token = getToken(ctx)))
 			break;
-		case '@':
+		if (*token == '@')
 			vrVerse(ctx);
-			break;
-		case '*':
-		case '=':
-		case '-':
-		case '%':
-		case '+':
-			EAT(ctx, token, ';');
-			break;
-		case '<':
-			EAT(ctx, token, '>');
-			break;
-		case '"':
-			EAT(ctx, token, '"');
-			break;
-		case '[':
+		else
 			vrReadings(ctx);
-			break;
+	}
+}
+
+/*
+	With more than one job, each takes a run of the entries and writes
+	them to a buffer, starting from the unit of the first [ in its run;
+	the buffers go to the .vr in order.
+*/
+static void
+	writeVr(Context *ctx)
+{
+	int nJobs = nShares(ctx, ctx->nVr), jj, ii, pc, var;
+	Context **vs = new(nJobs, Context *);
+	char **outs = new(nJobs, char *), **errs = new(nJobs, char *);
+	size_t *outLens = new(nJobs, size_t), *errLens = new(nJobs, size_t);
+
+	assert( vs && outs && errs && outLens && errLens );
+	ctx->var = 0;
+	ctx->wvar = 0;
+	vs[0] = ctx;
+	for (jj = 1, ii = pc = var = 0; jj < nJobs; jj++) {
+		Context *v = new(1, Context);
+		int lo = (int) ((long) ctx->nVr * jj / nJobs);
+
+		assert( v );
+		*v = *ctx;
+		for ( ; ii < lo; ii++) {
+			if (ctx->mssBuf[ctx->vrAt[ii]] == '[')
+				pc++;
 		}
+		for ( ; var < ((pc < ctx->nPiece) ? ctx->pieceVar[pc] : ctx->nVar); var++)
+			ctx->wvar += ctx->wgts[var];
+		v->var = var;
+		v->wvar = ctx->wvar;
+		memset(&v->counts, 0, sizeof v->counts);
+		v->nWarned = 0;
+		v->fpVr = open_memstream(&outs[jj], &outLens[jj]);
+		v->fpErr = open_memstream(&errs[jj], &errLens[jj]);
+		assert( v->fpVr && v->fpErr );
+		vs[jj] = v;
 	}
+	ctx->wvar = 0;
+	shareOut(ctx, 0, ctx->nVr, vrShare, vs);
+
+	for (jj = 1; jj < nJobs; jj++) {
+		Context *v = vs[jj];
+
+		fclose(v->fpVr);
+		fclose(v->fpErr);
+		fwrite(outs[jj], 1, outLens[jj], ctx->fpVr);
+		fwrite(errs[jj], 1, errLens[jj], ctx->fpErr);
+		addCounts(&ctx->counts, &v->counts);
+		ctx->nWarned += v->nWarned;
+		ctx->var = v->var;
+		ctx->wvar = v->wvar;
+		free(outs[jj]);
+		free(errs[jj]);
+		free(v);
+	}
+	free(vs);
+	free(outs);
+	free(errs);
+	free(outLens);
+	free(errLens);
 }
 
 static int
@@ -2015,3 +6932,616 @@ static int
 	}
 	return dimof(strattab);
 }
+
+/* ------------------------------------------------------
+||
+||  Chron files:  each is loaded once for the process, and kept while
+||  it is unchanged, so the collations (or runs, or libprep parses)
+||  that name the same file share it.  Its dates are read as
+||  "%s %d %d %d" was, but by hand, with the :hand split off once; with
+||  CACHE (or --watch), they are also kept in file.prepd beside it,
+||  keyed on its size and mtime, to skip even that.  ChronLock is held.
+||
+*/
+
+#define CHRONMAGIC "prepd 1\n"
+
+// As fscanf() takes a %d:  blanks, a sign and at least a digit.
+static int
+	scanInt(char **pp, char *end, int *n)
+{
+	char *p = *pp;
+	int neg = NO;
+	long v = 0;
+
+	while (p < end && isspace((unsigned char) *p))
+		p++;
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = (*p++ == '-');
+	if (p >= end || !isdigit((unsigned char) *p))
+		return NO;
+	while (p < end && isdigit((unsigned char) *p))
+		v = v * 10 + (*p++ - '0');
+	*n = (int) ((neg) ? -v : v);
+	*pp = p;
+	return YES;
+}
+
+// Read the dates in c->buf (len of text), to the first line that will not do.
+static void
+	parseChron(Chron *c, size_t len)
+{
+	char *p = c->buf, *end = c->buf + len;
+	int max = 0;
+
+	for (;;) {
+		ChronDate d;
+		char *colon;
+
+		while (p < end && isspace((unsigned char) *p))
+			p++;
+		if (p >= end)
+			break;
+		d.name = p;
+		while (p < end && !isspace((unsigned char) *p))
+			p++;
+		*p = EOS;			// buf has room for one at the end
+		if (p < end)
+			p++;
+		if (!scanInt(&p, end, &d.minD) || !scanInt(&p, end, &d.midD)
+		|| !scanInt(&p, end, &d.maxD))
+			break;
+		d.hand = 0;
+		if ((colon = strchr(d.name, ':'))) {
+			d.hand = atoi(colon+1);
+			*colon = EOS;
+		}
+		c->dates = growArray(c->dates, &max, c->nDates+1, sizeof (ChronDate));
+		c->dates[c->nDates++] = d;
+	}
+}
+
+// The dates of c as file.prepd had them, if that is as of c->stamp.
+static int
+	readChronCache(Chron *c, char *fn)
+{
+	CacheIn in[1];
+	struct stat st;
+	FILE *fp;
+	int ii;
+
+	if (!(fp = fopen(fn, "rb")))
+		return NO;
+	if (fstat(fileno(fp), &st) < 0 || !(c->buf = new(st.st_size + 1, char))) {
+		fclose(fp);
+		return NO;
+	}
+	in->p = (unsigned char *) c->buf;
+	in->end = in->p + fread(c->buf, 1, st.st_size, fp);
+	in->bad = NO;
+	fclose(fp);
+	if (in->end - in->p < strlen(CHRONMAGIC)
+	|| memcmp(in->p, CHRONMAGIC, strlen(CHRONMAGIC)) != 0
+	|| (in->p += strlen(CHRONMAGIC), getNum(in) != c->stamp[1])
+	|| getNum(in) != c->stamp[2]) {
+		free(c->buf);
+		c->buf = (char *) 0;
+		return NO;
+	}
+
+	c->nDates = getCount(in, in->end - in->p);
+	c->dates = new(c->nDates + 1, ChronDate);
+	assert( c->dates );
+	for (ii = 0; ii < c->nDates && !in->bad; ii++) {
+		ChronDate *d = &c->dates[ii];
+		uint64_t len = getNum(in);
+
+		// Names are kept with their EOS, so they can stay where they are
+		if (len == 0 || len > (uint64_t) (in->end - in->p) || in->p[len-1] != EOS) {
+			in->bad = YES;
+			break;
+		}
+		d->name = (char *) in->p;
+		in->p += len;
+		d->hand = getInt(in);
+		d->minD = getInt(in);
+		d->midD = getInt(in);
+		d->maxD = getInt(in);
+	}
+	if (in->bad) {
+		free(c->dates);
+		free(c->buf);
+		c->dates = (ChronDate *) 0;
+		c->buf = (char *) 0;
+		c->nDates = 0;
+		return NO;
+	}
+	return YES;
+}
+
+static void
+	writeChronCache(Chron *c, char *fn)
+{
+	char tmp[MAXTOKEN*2+1];
+	FILE *fp;
+	int ii;
+
+	snprintf(tmp, dimof(tmp), "%s~", fn);
+	if (!(fp = fopen(tmp, "wb")))
+		return;
+	fputs(CHRONMAGIC, fp);
+	putNum(fp, c->stamp[1]);
+	putNum(fp, c->stamp[2]);
+	putInt(fp, c->nDates);
+	for (ii = 0; ii < c->nDates; ii++) {
+		ChronDate *d = &c->dates[ii];
+		size_t len = strlen(d->name) + 1;
+
+		putNum(fp, len);
+		fwrite(d->name, 1, len, fp);
+		putInt(fp, d->hand);
+		putInt(fp, d->minD);
+		putInt(fp, d->midD);
+		putInt(fp, d->maxD);
+	}
+	if (ferror(fp) | fclose(fp))
+		remove(tmp);
+	else
+		rename(tmp, fn);
+}
+
+// The Chron file fn, as it is now (NULL if it cannot be read)
+static Chron *
+	loadChron(Context *ctx, char *fn)
+{
+	char cache[MAXTOKEN*2];
+	uint64_t stamp[3];
+	Chron *c, **cp;
+	FILE *fp;
+	size_t len;
+
+	stampFile(fn, stamp);
+	for (cp = &Chrons; (c = *cp); cp = &c->next) {
+		if (strcmp(c->fn, fn) != 0)
+			continue;
+		if (memcmp(c->stamp, stamp, sizeof stamp) == 0)
+			return c;
+
+		// It has changed:  runs before this one are done with it
+		*cp = c->next;
+		free(c->fn);
+		free(c->buf);
+		free(c->dates);
+		free(c);
+		break;
+	}
+
+	if (!(fp = fopen(fn, "r")))
+		return (Chron *) 0;
+	c = calloc(1, sizeof (Chron));
+	assert( c );
+	c->fn = strdup(fn);
+	assert( c->fn );
+	memcpy(c->stamp, stamp, sizeof stamp);
+
+	snprintf(cache, dimof(cache), "%s.prepd", fn);
+	if (!(getenv("CACHE") || ctx->watching) || !readChronCache(c, cache)) {
+		c->buf = new(stamp[1] + 1, char);
+		assert( c->buf );
+		len = fread(c->buf, 1, stamp[1], fp);
+		c->buf[len] = EOS;
+		parseChron(c, len);
+		if (getenv("CACHE") || ctx->watching)
+			writeChronCache(c, cache);
+	}
+	fclose(fp);
+	c->next = Chrons;
+	Chrons = c;
+	return c;
+}
+
+/* ------------------------------------------------------
+||
+||  Watch (--watch):  run, then wait for the collation or one of its
+||  Chron files to change, and run again.  Each run keeps the parse as
+||  CACHE does, so only the @ blocks edited are parsed again, and only
+||  the outputs that came out different are written.  On Linux, inotify
+||  on the files' directories wakes the wait (editors often save by
+||  renaming); elsewhere, and between events, the files are polled.
+||  It stops once the collation is gone (and stays gone past a save).
+||
+*/
+
+#define WATCHPOLL 1000			// ms between polls
+#define WATCHSETTLE 50			// ms for a save to finish
+
+// How fn is now (all zero if it is not there)
+static void
+	stampFile(char *fn, uint64_t stamp[3])
+{
+	struct stat st;
+
+	stamp[0] = stamp[1] = stamp[2] = 0;
+	if (stat(fn, &st) < 0)
+		return;
+	stamp[0] = st.st_ino;
+	stamp[1] = st.st_size;
+	stamp[2] = (uint64_t) st.st_mtim.tv_sec * 1000000000u + st.st_mtim.tv_nsec;
+}
+
+static void
+	addWatch(Watch *w, char *fn)
+{
+	int ii, max = w->maxFiles;
+
+	for (ii = 0; ii < w->nFiles; ii++) {
+		if (strcmp(w->files[ii], fn) == 0)
+			return;
+	}
+	w->files = growArray(w->files, &max, w->nFiles+1, sizeof (char *));
+	w->stamps = growArray(w->stamps, &w->maxFiles, w->nFiles+1, 3 * sizeof (uint64_t));
+	w->files[w->nFiles] = strdup(fn);
+	assert( w->files[w->nFiles] );
+	stampFile(fn, &w->stamps[3 * w->nFiles]);
+	w->nFiles++;
+
+#if defined(__linux__)
+	if (w->fd >= 0) {
+		char dir[MAXTOKEN*2], *s;
+
+		snprintf(dir, dimof(dir), "%s", fn);
+		if ((s = strrchr(dir, '/')))
+			*(s == dir ? s+1 : s) = EOS;
+		else
+			strcpy(dir, ".");
+		inotify_add_watch(w->fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+	}
+#endif
+}
+
+// Has a file changed since it was stamped?  If so, stamp them all afresh.
+static int
+	watchChanged(Watch *w)
+{
+	int ii, changed = NO;
+
+	for (ii = 0; ii < w->nFiles; ii++) {
+		uint64_t now[3];
+
+		stampFile(w->files[ii], now);
+		if (memcmp(now, &w->stamps[3*ii], sizeof now) != 0) {
+			memcpy(&w->stamps[3*ii], now, sizeof now);
+			changed = YES;
+		}
+	}
+	return changed;
+}
+
+static void
+	waitWatch(Watch *w)
+{
+	struct pollfd pfd;
+	char buf[4096];
+
+	pfd.fd = w->fd;
+	pfd.events = POLLIN;
+	while (!watchChanged(w)) {
+		if (poll(&pfd, (w->fd >= 0) ? 1 : 0, WATCHPOLL) > 0)
+			(void) !read(w->fd, buf, sizeof buf);
+	}
+
+	// Let the save finish, and take what it did as one change
+	do {
+		poll((struct pollfd *) 0, 0, WATCHSETTLE);
+	} while (watchChanged(w));
+}
+
+static int
+	watchMss(int argc, char *argv[])
+{
+	Watch w[1];
+	int ii;
+
+	if (argc < 2 || strcmp(argv[1], "-") == 0)
+		return run(argc, argv, (Watch *) 0);
+	memset(w, 0, sizeof w);
+#if defined(__linux__)
+	w->fd = inotify_init();
+#else
+	w->fd = -1;
+#endif
+	addWatch(w, argv[1]);
+	for (;;) {
+		double t[2];
+		int rc;
+
+		startPhase(t);
+		watchChanged(w);
+		rc = run(argc, argv, w);
+		printf("Done (%d) in %.3fs; watching %d file%s\n", rc,
+			seconds(CLOCK_MONOTONIC) - t[0], w->nFiles, (w->nFiles == 1) ? "" : "s");
+		fflush(stdout);
+		fflush(stderr);
+		waitWatch(w);
+		if (w->stamps[0] == 0)		// (No inode:  the collation is gone)
+			break;
+	}
+	for (ii = 0; ii < w->nFiles; ii++)
+		free(w->files[ii]);
+	free(w->files);
+	free(w->stamps);
+	if (w->fd >= 0)
+		close(w->fd);
+	return 0;
+}
+
+/* ------------------------------------------------------
+||
+||  libprep (see libprep.h):  the parse, then the suppression passes as
+||  often as wanted, each from the state the parse left and with its
+||  settings in place of the environment's.
+||
+*/
+
+Prep *
+	prepParse(char *collation, char **witnesses, FILE *fpErr)
+{
+	Context *ctx = calloc(1, sizeof (Context));
+	Status status;
+	int nWarn = 0, nSub, ii;
+	double t[2];
+
+	assert( ctx );
+	ctx->fpOut = ctx->fpErr = (fpErr) ? fpErr : stderr;
+	ctx->nJobs = 1;
+	for (nSub = 0; witnesses && witnesses[nSub]; nSub++)
+		;
+	ctx->subset = new(nSub + 1, char *);
+	assert( ctx->subset );
+	ctx->subset[0] = (char *) 0;
+	if (!openCollation(ctx, collation)) {
+		prepFree(ctx);
+		return (Prep *) 0;
+	}
+	startContext(ctx);
+
+	// Copies, as mandateTx() writes into the names
+	for (ii = 0; ii < nSub; ii++)
+		ctx->subset[ii] = arenaStr(&ctx->arena, witnesses[ii]);
+	ctx->subset[nSub] = (char *) 0;
+
+	startPhase(t);
+	status = parseMss(ctx, t, &nWarn);
+	if (status == FATAL || ctx->nMSS == 0 || nWarn > 0) {
+		prepFree(ctx);
+		return (Prep *) 0;
+	}
+	mandateTx(ctx);
+	ctx->parsed = new(1, Snapshot);
+	assert( ctx->parsed );
+	saveState(ctx, ctx->parsed);
+	return ctx;
+}
+
+// Does hand a come before hand b, as the .no has it (but for b itself)?
+static int
+	handBefore(const PrepHand *a, const PrepHand *b)
+{
+	if (b->earliest > a->latest)
+		return YES;
+	return a->parallel == b->parallel && a->witness == b->witness && a->hand < b->hand;
+}
+
+// The active hands, in .tx order, for prepHands(), and the hands before
+// each, for prepPreceding()
+static void
+	activeHands(Context *ctx)
+{
+	int pp, ms, hh, nn = 0, max = 0, aa, bb;
+	size_t len = 0;
+	char *s;
+
+	free(ctx->active);
+	free(ctx->activeNames);
+	free(ctx->preceding);
+	free(ctx->precedingAt);
+	ctx->nActive = activeMSS(ctx);
+	ctx->active = new(ctx->nActive + 1, PrepHand);
+	assert( ctx->active );
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		for (hh = 0; hh < MAXHAND; hh++) {
+			if (!ctx->par[pp].msHands[ms][hh].suppressed)
+				len += strlen(parName(ctx, pp, w->corrected, hh, w->pname)) + 1;
+		}
+	}
+	s = ctx->activeNames = new(len + 1, char);
+	assert( s );
+	for (pp = 0; pp < ctx->nParallels; pp++)
+	for (ms = 0; ms < ctx->nMSS; ms++) {
+		Witness *w = &ctx->mss[ms];
+		Hand *hands = ctx->par[pp].msHands[ms];
+
+		for (hh = 0; hh < MAXHAND; hh++) {
+			PrepHand *a = &ctx->active[nn];
+
+			if (hands[hh].suppressed)
+				continue;
+			a->name = strcpy(s, parName(ctx, pp, w->corrected, hh, w->pname));
+			s += strlen(s) + 1;
+			a->row = &ctx->mat.rows[hands[hh].row * ctx->mat.nCols];
+			a->stratum = hands[hh].stratum;
+			a->earliest = hands[hh].earliest;
+			a->latest = hands[hh].latest;
+			a->parallel = pp;
+			a->witness = ms;
+			a->hand = hh;
+			nn++;
+		}
+	}
+
+	ctx->precedingAt = new(ctx->nActive + 1, int);
+	ctx->preceding = (int *) 0;
+	assert( ctx->precedingAt );
+	for (bb = nn = 0; bb < ctx->nActive; bb++) {
+		ctx->precedingAt[bb] = nn;
+		for (aa = 0; aa < ctx->nActive; aa++) {
+			if (!handBefore(&ctx->active[aa], &ctx->active[bb]))
+				continue;
+			ctx->preceding = growArray(ctx->preceding, &max, nn+1, sizeof (int));
+			ctx->preceding[nn++] = aa;
+		}
+	}
+	ctx->precedingAt[ctx->nActive] = nn;
+}
+
+int
+	prepSuppress(Prep *ctx, const PrepSettings *settings)
+{
+	static const PrepSettings defaults;
+	double t[2];
+
+	restoreState(ctx, ctx->parsed);
+	ctx->settings = (settings) ? settings : &defaults;
+	ctx->nJobs = (ctx->settings->jobs > 1) ? ctx->settings->jobs : 1;
+	YearGran = ctx->settings->yearGran;
+
+	startPhase(t);
+	suppress(ctx, t);
+	stratify(ctx);
+	activeHands(ctx);
+	ctx->settings = (const PrepSettings *) 0;
+	return ctx->nActive;
+}
+
+const PrepHand *
+	prepHands(Prep *ctx, int *nHands)
+{
+	*nHands = ctx->nActive;
+	return ctx->active;
+}
+
+const int *
+	prepWeights(Prep *ctx, int *nUnits)
+{
+	*nUnits = ctx->nVar;
+	return ctx->wgts;
+}
+
+const int *
+	prepPreceding(Prep *ctx, int h, int *nPreceding)
+{
+	assert( h >= 0 && h < ctx->nActive );
+	*nPreceding = ctx->precedingAt[h+1] - ctx->precedingAt[h];
+	return ctx->preceding + ctx->precedingAt[h];
+}
+
+int
+	prepBefore(Prep *ctx, int a, int b)
+{
+	assert( a >= 0 && a < ctx->nActive && b >= 0 && b < ctx->nActive );
+	return handBefore(&ctx->active[a], &ctx->active[b]);
+}
+
+void
+	prepFree(Prep *ctx)
+{
+	int pp, ms, hh, ii;
+
+	for (pp = 0; pp < ctx->nParallels; pp++) {
+		for (ms = 0; ms < ctx->nMSS; ms++) {
+			for (hh = 0; hh < MAXHAND; hh++) {
+				free(ctx->par[pp].msHands[ms][hh].sets);
+				free(ctx->par[pp].msHands[ms][hh].pcs);
+				free(ctx->par[pp].msHands[ms][hh].pcSets);
+			}
+		}
+	}
+	for (pp = 0; pp < dimof(ctx->par) && ctx->par[pp].pMacros; pp++) {
+		for (ii = 0; ii < MAXMACRO; ii++) {
+			Macro *m = ctx->par[pp].pMacros[ii];
+			if (m) {
+				free(m->inset);
+				free(m);
+			}
+		}
+		free(ctx->par[pp].pMacros);
+	}
+	for (ii = 0; ii < ctx->nChron; ii++)
+		free(ctx->chronFiles[ii]);
+	free(ctx->chronFiles);
+	for (ii = 0; ii < ctx->nNew; ii++) {
+		unsigned char *fx = ctx->newBlocks[ii].fx;
+		if (!ctx->oldBuf || fx < (unsigned char *) ctx->oldBuf
+		|| fx > (unsigned char *) ctx->oldBuf + ctx->oldLen)
+			free(fx);
+	}
+	free(ctx->newBlocks);
+	free(ctx->oldBlocks);
+	free(ctx->oldIndex);
+	free(ctx->oldBuf);
+	free(ctx->blk.touched);
+	free(ctx->blk.seen);
+	free(ctx->blk.rows);
+	free(ctx->blk.codes);
+	free(ctx->blk.slots);
+	free(ctx->blk.grid);
+	endChunks(ctx);
+	free(ctx->chunks);
+	free(ctx->lacunae);
+	free(ctx->rangeFrom);
+	free(ctx->marks);
+	free(ctx->marksBuf);
+	free(ctx->pools);
+	free(ctx->poolSrcs);
+	if (ctx->parsed) {
+		free(ctx->parsed->wgts);
+		free(ctx->parsed->corrected);
+		free(ctx->parsed->hands);
+		free(ctx->parsed);
+	}
+	free(ctx->active);
+	free(ctx->activeNames);
+	free(ctx->preceding);
+	free(ctx->precedingAt);
+	free(ctx->mat.rows);
+	free(ctx->mat.cols);
+	free(ctx->txCol);
+	free(ctx->vrAt);
+	free(ctx->nRdgs);
+	free(ctx->wgts);
+	free(ctx->pieceUnits);
+	free(ctx->pieceVar);
+	free(ctx->pieceSet);
+	free(ctx->states);
+	free(ctx->interned);
+	free(ctx->nameIndex);
+	free(ctx->alandIndex);
+	free(ctx->alandNext);
+	free(ctx->mss);
+	free(ctx->subset);
+	for (ii = 0; ii < ctx->nSweep; ii++) {
+		free(ctx->sweep[ii].name);
+		free(ctx->sweep[ii].values);
+	}
+	free(ctx->sweep);
+	free(ctx->sweepAt);
+	for (ii = 0; ii < ctx->nGroups; ii++) {
+		free(ctx->groups[ii].tag);
+		free(ctx->groups[ii].subset);
+	}
+	free(ctx->groups);
+	if (ctx->stats) {
+		free(ctx->stats->phases);
+		free(ctx->stats);
+	}
+	freeArena(&ctx->arena);
+	if (ctx->mssMapped)
+		munmap(ctx->mssBuf, ctx->mssLen);
+	else
+		free(ctx->mssBuf);
+	if (ctx->fpMss && ctx->fpMss != stdin)
+		fclose(ctx->fpMss);
+	free(ctx);
+}
@@ -4,15 +4,30 @@
 
 #define MAXHAND 8
 #define MAXPARS 3
+#define MAXEDWORDS 64
 
 #define dimof(a) (sizeof a/sizeof a[0])
+
+// Packed bitsets, 64 witnesses to a word
+#define BITWORDS(n)   (((n) + 63) / 64)
+#define BITTEST(b, i) (((b)[(i) >> 6] >> ((i) & 63)) & 1)
+#define BITSET(b, i)  ((b)[(i) >> 6] |= (uint64_t) 1 << ((i) & 63))
+#define BITCLR(b, i)  ((b)[(i) >> 6] &= ~((uint64_t) 1 << ((i) & 63)))
 #define NO 0
 #define YES 1
 #define EOS '\0'
 
+// Bump allocator for what lives as long as the Context (see arenaAlloc())
+typedef struct arena Arena;
+struct arena {
+	char *p, *end;				// Free space in the current block
+	char **blocks;				// All the blocks, for freeArena()
+	int nBlocks, maxBlocks;
+};
+
 typedef struct hand Hand;
 struct hand {
-	char **sets;					// States for each piece set
+	char **sets;					// States for each piece (hand 0 only)
 	int earliest, average, latest;	// Chrono possibilities
 	int stratum;					// Chronological stratum
 	int suppressed;					// Suppressed?
@@ -20,6 +35,11 @@ struct hand {
 	int inLacuna;					// Witness is lacunose (defaults to MISSING)
 	int level;						// Priority level for current piece
 	int lastHand;					// Previous hand
+	int row;						// Row in the resolved Matrix (or -1)
+	int nExtant;					// Weighted units extant (hand 0)
+	int *pcs;						// Pieces with readings of this corrector, in order
+	char **pcSets;					// ... and the readings
+	int nPcs, maxPcs;				// ... used and allocated
 };
 
 typedef struct witness Witness;
@@ -33,7 +53,7 @@ struct witness {
 typedef struct macro Macro;
 struct macro {
 	int level;					// Priority level of macro * = 0, ? = hi
-	int *inset;					// Set of witnesses in the set
+	uint64_t *inset;			// Bitset of witnesses in the set
 };
 
 typedef struct parallel Parallel;
@@ -44,6 +64,151 @@ struct parallel {
 	Macro **pMacros;			// 256 macros, indexed by character
 };
 
+// Resolved states:  lastHand inheritance and ROOT/MISSING defaults applied
+typedef struct matrix Matrix;
+struct matrix {
+	int nRows;					// Distinct resolved rows
+	int nCols;					// Variation units
+	char *rows;					// nRows x nCols, row-major
+	int nTally;					// Rows in the column tally (see buildMatrix)
+	char *cols;					// nCols x nTally, column-major
+};
+
+// One variable of a --sweep, and the values it takes
+typedef struct sweepVar SweepVar;
+struct sweepVar {
+	char *name;					// Environment variable (FRAG, CORR, ...)
+	char **values;				// Its values, "" to unset it
+	int nValues;
+};
+
+// What the suppression passes change, to start each sweep afresh
+typedef struct snapshot Snapshot;
+struct snapshot {
+	int wvar;					// Weighted variation units
+	int *wgts;					// Unit weights
+	int *corrected;				// Witness.corrected
+	Hand *hands;				// Parallels x MSS x MAXHAND
+};
+
+// A +TAG: group of witnesses from the command-line, and what it printed
+typedef struct group Group;
+struct group {
+	char *tag;					// Output files are base.TAG.{tx,no,vr}
+	char **subset;				// Its witnesses, as for Context.subset
+	int nSubset;
+	char *out, *err;			// Held-back stdout and stderr
+	size_t outLen, errLen;
+};
+
+// Reading back a .prepc parse cache
+typedef struct cacheIn CacheIn;
+struct cacheIn {
+	const unsigned char *p, *end;	// Unread part of the cache
+	int bad;						// Ran off the end or found nonsense
+};
+
+// One @ block of a clean parse, as kept in base.prepb
+typedef struct block Block;
+struct block {
+	uint64_t key;				// Stateful commands before it, parallel and verse
+	uint64_t hash;				// Hash of its text
+	size_t len;					// ... and the length of that text
+	long lines;					// Lines it moves the tokenizer on
+	long tokenLine;				// ... token_lineno after it, from its start (or -1)
+	int incLine;				// ... and inc_line_p after it
+	unsigned char *fx;			// Its effects on the parse (see replayBlock())
+	size_t fxLen;
+};
+
+// The @ block being parsed, while its effects are noted
+typedef struct blockRec BlockRec;
+struct blockRec {
+	int open;					// In a block
+	int dirty;					// Cannot be replayed, so is not kept
+	uint64_t key;				// As for Block
+	size_t start;				// Offset of its @
+	unsigned long lineno;		// Line number just after the @
+	int var, piece, set;		// Its first unit, piece and set
+	int vr;						// ... and entry in vrAt
+	char position[MAXPARS][MAXTOKEN];	// Positions as it began
+	int *touched;				// Hands assigned to, as pp * nMSS + ms
+	int nTouched, maxTouched;
+	int *seen;					// Each one's nExtant as the block found it (or -1),
+	int maxSeen;				// ... and if noteHand() was to take all its hands
+	Hand **rows;				// Scratch:  the hands of a block
+	int *codes;					// ... a column of its effects
+	int *slots;					// ... the sets of a piece, hashed
+	char **grid;				// ... and the readings of a few pieces
+	int maxRows, maxCodes, maxSlots, maxGrid;
+	size_t endPos;				// Tokenizer state after the last command
+	unsigned long endLine;
+	int endInc;
+};
+
+// A run of @ blocks parsed on a worker thread (-j), then spliced in whole
+typedef struct chunk Chunk;
+struct chunk {
+	size_t start, end;			// Its text
+	unsigned long lineno;		// Tokenizer state at its start
+	int incLine;
+	int parallel;				// ... and the parallel
+	int ok;						// Parsed cleanly, so can be spliced in
+	struct context *w;			// The worker that parsed it, holding what it did
+	unsigned long lines;		// Lines it took
+	long tokenLine;				// ... the last command's line, relative (or -1)
+	int endInc;					// ... and inc_line_p at its end
+};
+
+// A % in a stretch parsed by workers (-j), for the chunks after it
+typedef struct lacuna Lacuna;
+struct lacuna {
+	size_t pos;					// Tokenizer state just before it
+	int parallel;
+};
+
+// A top-level @ or stateful command, as base.prepi has it (--range)
+typedef struct mark Mark;
+struct mark {
+	int cmd;					// Its first character
+	size_t pos;					// Tokenizer state just before it
+	unsigned long lineno;
+	int incLine;
+	char *verse;				// The verse, for an @
+};
+
+// An & command:  witness ms (of a parallel) made the pool of its sources
+typedef struct pool Pool;
+struct pool {
+	int parallel;
+	int ms;						// The pooled witness
+	int from, nSrcs;			// Its sources, in Context.poolSrcs
+};
+
+// What a run did, for --stats (workers keep their own, added in after)
+typedef struct counts Counts;
+struct counts {
+	unsigned long tokens;		// Read by getToken()
+	unsigned long findMSS;		// Witnesses looked up
+	unsigned long macros;		// Macros looked up and found
+	unsigned long interns;		// States interned, new or not
+};
+
+// A phase of the run, timed
+typedef struct phase Phase;
+struct phase {
+	const char *name;
+	double wall, cpu;			// Seconds
+	long maxRss;				// Peak memory so far, in KB
+};
+
+typedef struct stats Stats;
+struct stats {
+	Phase *phases;
+	int nPhases, maxPhases;
+	long bytes[5];				// Written to .tx, .no, .vr, .txb and .dm
+};
+
 typedef struct context Context;
 struct context {
 	unsigned long lineno;		// Current Line Number
@@ -53,9 +218,26 @@ struct context {
 	unsigned long token_lineno;	// Line Number of Token
 
 	FILE *fpMss;				// .mss file (in)
+	char *mssBuf;				// Contents of the .mss file (mapped or read)
+	size_t mssLen;				// Length of mssBuf
+	size_t mssPos;				// Read position within mssBuf
+	int mssMapped;				// mssBuf is mmap()'d, not malloc()'d
+	char *tokp;					// Current token, as a view into mssBuf
+	int toklen;					// Length of the current token view
 	FILE *fpTx;					// .tx file (out)
 	FILE *fpVr;					// .vr file (out)
 	FILE *fpNo;					// .no file (out)
+	FILE *fpTxb;				// .txb file (out, if TXB)
+	FILE *fpDm;					// .dm file (out, if DM)
+	char *base;					// Base name of the output files
+	FILE *fpOut;				// Where the passes print (stdout)
+	FILE *fpErr;				// ... and warn (stderr)
+
+	int nSweep;					// Variables swept (0 for a single run)
+	SweepVar *sweep;			// Swept variables, last varies fastest
+	int *sweepAt;				// Value of each being used (or 0)
+	int nGroups;				// Subset groups (0 for just ctx->subset)
+	Group *groups;
 
 	int nParallels;				// Number of Parallel Witnesses
 	int parallel;				// Which parallel
@@ -63,29 +245,171 @@ struct context {
 	
 	int nMSS;					// Number of MSS
 	Witness *mss;				// Each of the witnesses
+	int mssMask;				// Slots-1 in the witness indexes
+	int *nameIndex;				// Open-addressed index of mss by name
+	int *alandIndex;			// Open-addressed index of mss by Aland
+	int *alandNext;				// Next witness with the same Aland
+	int alandStale;				// alandIndex must be rebuilt (after ~)
 
 	char **subset;              // Selected subset of witnesses (from command-line)
 
 	int nVar;					// Number of variation units
 	int var;					// Current variation unit
 	int wvar;					// Current weighted variation unit
+	int maxVar;					// Allocated variation units
 	int *nRdgs;					// Number of readings for each unit
 	int *wgts;					// Weight of each unit, *0 means suppress
 	int weighByED;				// Weigh variants by provided edit-distance
+	int autoED;					// ... or plain ones by word edit-distance, binned by it
+	uint64_t edLem[MAXEDWORDS];	// Words of the last lemma (in this @ block) for AUTOED
+	int nEdLem;					// ... and how many
 
 	int nPiece;					// Number of pieces (complex var units)
 	int piece;					// Current piece
+	int maxPiece;				// Allocated pieces
 	int *pieceUnits;			// Number of variation units in each piece
+	int *pieceVar;				// First variation unit of each piece
+	int *pieceSet;				// First set of each piece
 
 	int nSets;					// Number of sets
 	int set;					// Current set
-	char **states;				// States of each set
+	int maxSets;				// Allocated sets
+	char **states;				// States of each set (interned)
+
+	Arena arena;				// Names, hands and states
+	char **interned;			// Open-addressed set of the states in arena
+	unsigned internMask;		// ... slots-1
+	int nInterned;
+
+	size_t *vrAt;				// Offsets of the @ and [ commands, for writeVr()
+	int nVr, maxVr;
+
+	Pool *pools;				// The & commands, done after the parse
+	int nPools, maxPools;
+	int *poolSrcs;				// ... their sources, (ms, hand or -1 for all)
+	int nPoolSrcs, maxPoolSrcs;
+
+	Matrix mat;					// Resolved states of the active hands
+	int *txCol;					// .tx column of each unit, if COMPACTTX
 
 	int macLevel;				// Macro level
+	int macWords;				// Words in each macro bitset
 
 	char *Root;					// Has root? If so, its name.
+	int rootSet;				// ROOT is in the environment (if empty, for none)
 
 	int didChron;				// Did the chron file.
+	int nChron;					// Chron files read
+	char **chronFiles;			// ... and their names, for the cache
+	int nWarned;				// Warnings printed by fWarn()
+
+	int blocks;					// Keeping @ blocks (CACHE set)
+	uint64_t chain;				// Hash of the stateful commands so far
+	BlockRec blk;				// Block being parsed
+	Block *newBlocks;			// Blocks of this parse, for base.prepb
+	int nNew, maxNew;
+	Block *oldBlocks;			// Blocks of the last parse, to reuse
+	int nOld;
+	int *oldIndex;				// Open-addressed on key
+	unsigned oldMask;
+	char *oldBuf;				// The old base.prepb (fx of the blocks reused)
+	size_t oldLen;
+
+	int nJobs;					// Worker threads for parsing (-j)
+	int jobAt;					// A worker's chunk
+	Context **workers;			// ... and the workers, for the stretch
+	int nWorkers;
+	char *errBuf;				// A worker's warnings (dropped)
+	size_t errLen;
+	Chunk *chunks;				// Chunks of the stretch being parsed
+	int nChunks, maxChunks;
+	int atChunk;				// Next one to splice in
+	int waveEnd;				// ... and the first not yet parsed
+	size_t skimTo;				// Where the stretch ends
+	Lacuna *lacunae;			// Its % commands
+	int nLacunae, maxLacunae;
+	int atLacuna;				// The first a worker has yet to apply
+
+	char *rangeFrom, *rangeTo;	// --range @from-@to, or NULL
+	Mark *marks;				// The collation's @ and stateful commands
+	int nMarks, maxMarks;
+	char *marksBuf;				// ... as read from base.prepi
+	int rangeEnd;				// The mark after the range
+	size_t mssEnd;				// ... and mssLen, while it is parsed
+
+	Counts counts;				// What was done (see Counts)
+	Stats *stats;				// Phases timed (--stats), or NULL
+
+	int watching;				// Under --watch:  outputs are kept in memory
+	char *outBuf[5];			// ... for .tx, .no, .vr, .txb and .dm
+	size_t outLen[5];
+
+	const PrepSettings *settings;	// In place of the environment (libprep)
+	Snapshot *parsed;			// ... the state to suppress from afresh
+	PrepHand *active;			// ... and the hands it left active
+	int nActive;
+	char *activeNames;
+	int *preceding;				// ... the hands before each, as prepPreceding()
+	int *precedingAt;			// ... from where each one's start (nActive+1)
+};
+
+// A date of a Chron file:  the Gregory-Aland name and hand, and its years
+typedef struct chronDate ChronDate;
+struct chronDate {
+	char *name;					// Without the :hand
+	int hand;
+	int minD, midD, maxD;
+};
+
+// The bitplanes of the matrix for base.dm (DM), and the counts for each pair
+typedef struct planes Planes;
+struct planes {
+	int nHands, nWords;			// Hands, and 64 units a word
+	int nPlanes;				// Bits of a state code
+	uint64_t *bits;				// Hand x word x (attested, then the code's bits)
+	int *wordWgt;				// Weight of the units in each word
+	int *tiles, nTiles;			// Pairs of tiles of hands, (i, j) with i <= j
+	unsigned *agree, *comp;		// Agreements and units comparable, a pair
+	unsigned *dist;				// ... and the weight of the disagreements
+};
+
+// A Chron file, as loaded once for the process (see loadChron())
+typedef struct chron Chron;
+struct chron {
+	char *fn;
+	uint64_t stamp[3];			// As stampFile() had it when loaded
+	char *buf;					// Its text, or its .prepd (the names are in it)
+	ChronDate *dates;
+	int nDates;
+	Chron *next;
+};
+
+// --watch:  the files a run reads, and how they were when it began
+typedef struct watch Watch;
+struct watch {
+	char **files;				// The collation, then its Chron files
+	uint64_t *stamps;			// ... inode, size and mtime (ns), 3 a file
+	int nFiles, maxFiles;
+	int fd;						// inotify, or -1 (to poll)
+};
+
+// A job's share of a phase after the parse (-j):  items [lo, hi) of it
+typedef struct share Share;
+struct share {
+	Context *ctx;
+	int job;					// Which share
+	int lo, hi;
+	void *arg;					// The phase's own
+	void (*fn)(Share *);
+};
+
+// The lines a writer shares out, a hand each, and each job's output
+typedef struct lines Lines;
+struct lines {
+	int *hands;					// (pp, ms, hh) a line, in order
+	int *runs, nRuns;			// Weights, as runs (see writeTx())
+	char **out;					// A block of lines for each job
+	size_t *used;				// ... and what is in it
 };
 
 #define NO  0